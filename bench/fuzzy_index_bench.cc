@@ -0,0 +1,115 @@
+// Fuzzy search latency benchmark.
+//
+// Builds a FuzzyIndex the way PasswordManager does: every entry contributes
+// its name, a website host "<label>.com" and the host label itself, so
+// 100,000 entries give about 300,000 terms. Two name distributions are run:
+//
+//   random    - 6 to 14 uniformly random lowercase letters
+//   syllables - 2 to 4 syllables of consonant + vowel (+ optional consonant)
+//
+// Queries are 2,000 existing names or labels, cut to a random length of 1 to
+// 14 characters and given 0 to 2 random edits (substitution, deletion,
+// insertion or adjacent transposition). All randomness uses a fixed seed, so
+// runs are reproducible. Results are reported per query length bucket, which
+// is what the allowed edit distance depends on. The maximum is sensitive to
+// scheduling noise; p99 is the more stable tail figure.
+//
+// Configure with -DCMAKE_BUILD_TYPE=Release so the index is optimized, then run:
+//   ./fuzzy_index_bench [entries]
+#include "fuzzy_index.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string randomName(std::mt19937 &rng) {
+    std::string name(6 + rng() % 9, 'a');
+    for (auto &c : name) c = static_cast<char>('a' + rng() % 26);
+    return name;
+}
+
+std::string syllableName(std::mt19937 &rng) {
+    static const std::string consonants = "bcdfghjklmnprstvwz";
+    static const std::string vowels = "aeiou";
+    std::string name;
+    for (size_t i = 0, n = 2 + rng() % 3; i < n; ++i) {
+        name += consonants[rng() % consonants.size()];
+        name += vowels[rng() % vowels.size()];
+        if (rng() % 3 == 0) name += consonants[rng() % consonants.size()];
+    }
+    return name;
+}
+
+std::string makeQuery(std::mt19937 &rng, std::string text) {
+    text.resize(std::min<size_t>(text.size(), 1 + rng() % 14));
+    for (size_t edits = rng() % 3; edits > 0 && text.size() > 1; --edits) {
+        size_t at = rng() % text.size();
+        char c = static_cast<char>('a' + rng() % 26);
+        switch (rng() % 4) {
+        case 0: text[at] = c; break;
+        case 1: text.erase(at, 1); break;
+        case 2: text.insert(text.begin() + at, c); break;
+        default:
+            if (at + 1 < text.size()) std::swap(text[at], text[at + 1]);
+        }
+    }
+    return text;
+}
+
+void run(const char *label, std::string (*generate)(std::mt19937 &), size_t entries) {
+    std::mt19937 rng(42);
+    std::vector<std::pair<std::string, std::string>> terms;
+    for (size_t i = 0; i < entries; ++i) {
+        std::string name = generate(rng);
+        std::string host = generate(rng);
+        terms.emplace_back(name, name);
+        terms.emplace_back(host + ".com", name);
+        terms.emplace_back(host, name);
+    }
+    FuzzyIndex index;
+    index.assign(terms);
+
+    struct Bucket {
+        const char *name;
+        std::vector<double> us;
+    };
+    Bucket buckets[] = {{"1-2 chars", {}}, {"3-5 chars", {}}, {"6+ chars", {}}};
+
+    for (int q = 0; q < 2000; ++q) {
+        std::string query = makeQuery(rng, terms[rng() % terms.size()].first);
+        auto start = std::chrono::steady_clock::now();
+        auto matches = index.search(query, 10);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        buckets[query.size() <= 2 ? 0 : query.size() <= 5 ? 1 : 2].us.push_back(us);
+    }
+
+    std::cout << label << " names, " << entries << " entries, " << terms.size() << " terms\n";
+    for (auto &bucket : buckets) {
+        std::vector<double> &us = bucket.us;
+        if (us.empty()) continue;
+        std::sort(us.begin(), us.end());
+        double total = 0;
+        for (double t : us) total += t;
+        std::cout << "  " << std::setw(9) << bucket.name << ": " << std::setw(5) << us.size() << " queries, avg "
+                  << std::fixed << std::setprecision(1) << total / us.size() << " us, p50 " << us[us.size() / 2]
+                  << " us, p99 " << us[us.size() * 99 / 100] << " us, max " << us.back() << " us\n";
+    }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    size_t entries = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    run("random", randomName, entries);
+    run("syllables", syllableName, entries);
+    return 0;
+}
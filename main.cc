@@ -6,6 +6,7 @@
 #include <cctype>
 #include <fstream>
 #include <algorithm>
+#include <ctime>
 
 bool fileExists(const std::string &filename)
 {
@@ -13,8 +14,68 @@ bool fileExists(const std::string &filename)
     return file.good();
 }
 
-int main()
+// Expands a partially typed value to the single matching value of the field,
+// or lists the candidates when the input is ambiguous.
+std::string resolveCompletion(const PasswordManager &manager, CompletionField field, const std::string &input)
 {
+    if (input.empty())
+        return input;
+
+    auto matches = manager.complete(field, input, 10);
+    if (std::find(matches.begin(), matches.end(), input) != matches.end())
+        return input;
+
+    if (matches.size() == 1)
+    {
+        std::cout << "Using \"" << matches[0] << "\".\n";
+        return matches[0];
+    }
+    if (!matches.empty())
+    {
+        std::cout << "Matching entries:\n";
+        for (const auto &match : matches)
+        {
+            std::cout << "- " << match << "\n";
+        }
+    }
+    return input;
+}
+
+// Shell integration: password_manager --complete <name|category|website> <file> [prefix]
+int printCompletions(int argc, char *argv[])
+{
+    const std::string fieldName = argv[2];
+    CompletionField field;
+    if (fieldName == "name")
+        field = CompletionField::Name;
+    else if (fieldName == "category")
+        field = CompletionField::Category;
+    else if (fieldName == "website")
+        field = CompletionField::Website;
+    else
+    {
+        std::cerr << "Unknown completion field: " << fieldName << "\n";
+        return 1;
+    }
+
+    const std::string filename = argv[3];
+    if (!fileExists(filename))
+        return 1;
+
+    for (const auto &value : PasswordManager::completeFromFile(filename, field, argc > 4 ? argv[4] : "", 50))
+    {
+        std::cout << value << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 4 && std::string(argv[1]) == "--complete")
+    {
+        return printCompletions(argc, argv);
+    }
+
     std::string filename;
     std::cout << "Enter name of the file: ";
     std::getline(std::cin, filename);
@@ -35,7 +96,18 @@ int main()
                   << "5. Delete password\n"
                   << "6. Add category\n"
                   << "7. Delete category\n"
-                  << "8. Exit\n"
+                  << "8. Check vault consistency\n"
+                  << "9. Vacuum vault\n"
+                  << "10. Toggle compressed storage\n"
+                  << "11. Compression report\n"
+                  << "12. Fuzzy search\n"
+                  << "13. Undo\n"
+                  << "14. Redo\n"
+                  << "15. Show version history\n"
+                  << "16. Show entry history\n"
+                  << "17. View vault at version\n"
+                  << "18. Prune history\n"
+                  << "19. Exit\n"
                   << "Choose an option: ";
 
         int choice = 0;
@@ -154,6 +226,7 @@ int main()
             {
                 std::cout << "Enter category name: ";
                 std::getline(std::cin, pwd.category);
+                pwd.category = resolveCompletion(manager, CompletionField::Category, pwd.category);
             }
             else
             {
@@ -170,7 +243,15 @@ int main()
             std::cout << "Login (optional): ";
             std::getline(std::cin, pwd.login);
 
-            manager.addPassword(pwd);
+            if (manager.addPassword(pwd))
+            {
+                std::cout << "Password added successfully.\n";
+            }
+            else
+            {
+                std::cout << "Failed to add password.\n";
+            }
+
             break;
         }
         case 4:
@@ -178,6 +259,7 @@ int main()
             std::string name;
             std::cout << "Enter the name of the password to edit: ";
             std::getline(std::cin, name);
+            name = resolveCompletion(manager, CompletionField::Name, name);
 
             const auto &passwords = manager.getPasswords();
             auto it = std::find_if(passwords.begin(), passwords.end(),
@@ -233,6 +315,7 @@ int main()
             std::string name;
             std::cout << "Enter name of the password to delete: ";
             std::getline(std::cin, name);
+            name = resolveCompletion(manager, CompletionField::Name, name);
 
             std::cout << "Are you sure you want to delete this password? (y/n): ";
             char confirm;
@@ -283,6 +366,148 @@ int main()
             break;
         }
         case 8:
+        {
+            std::vector<std::string> problems;
+            if (manager.checkConsistency(problems))
+            {
+                std::cout << "Vault is consistent.\n";
+            }
+            else
+            {
+                std::cout << "Vault has problems:\n";
+                for (const auto &problem : problems)
+                {
+                    std::cout << "- " << problem << "\n";
+                }
+            }
+            break;
+        }
+        case 9:
+        {
+            if (manager.vacuum())
+            {
+                std::cout << "Vault compacted.\n";
+            }
+            else
+            {
+                std::cout << "Failed to compact vault.\n";
+            }
+            break;
+        }
+        case 10:
+        {
+            bool compressed = !manager.isCompressedStorage();
+            if (manager.setCompressedStorage(compressed))
+            {
+                std::cout << "Vault now uses " << (compressed ? "compressed" : "plain") << " storage.\n";
+            }
+            else
+            {
+                std::cout << "Failed to change storage mode.\n";
+            }
+            break;
+        }
+        case 11:
+        {
+            manager.printCompressionReport();
+            break;
+        }
+        case 12:
+        {
+            std::string query;
+            std::cout << "Enter name or website (typos allowed): ";
+            std::getline(std::cin, query);
+
+            auto matches = manager.fuzzySearch(query, 10);
+            if (matches.empty())
+            {
+                std::cout << "No close matches found.\n";
+            }
+            for (const auto &match : matches)
+            {
+                std::cout << match.name << " (matched \"" << match.term << "\", distance "
+                          << match.distance << ", score " << match.score << ")\n";
+            }
+            break;
+        }
+        case 13:
+        {
+            if (manager.undo())
+            {
+                std::cout << "Last change undone.\n";
+            }
+            break;
+        }
+        case 14:
+        {
+            if (manager.redo())
+            {
+                std::cout << "Change redone.\n";
+            }
+            break;
+        }
+        case 15:
+        {
+            manager.printHistory();
+            break;
+        }
+        case 16:
+        {
+            std::string name;
+            std::cout << "Enter name of the password: ";
+            std::getline(std::cin, name);
+            manager.printEntryHistory(resolveCompletion(manager, CompletionField::Name, name));
+            break;
+        }
+        case 17:
+        {
+            uint64_t version = 0;
+            std::cout << "Version number: ";
+            std::cin >> version;
+            std::cin.ignore();
+
+            PersistentEntryMap view;
+            if (!manager.viewAt(version, view))
+            {
+                std::cout << "Version not found.\n";
+                break;
+            }
+            std::cout << "Vault as of version " << version << " (" << view.size() << " entries):\n";
+            view.forEach([](uint64_t, const Password &pwd)
+                         { std::cout << "Name: " << pwd.name << "\n"
+                                     << "Password: " << pwd.password << "\n"
+                                     << "Category: " << pwd.category << "\n"
+                                     << "Website: " << pwd.website << "\n"
+                                     << "Login: " << pwd.login << "\n\n"; });
+            break;
+        }
+        case 18:
+        {
+            std::cout << "Prune by (c)ount or (a)ge? ";
+            char mode;
+            std::cin >> mode;
+            mode = std::tolower(mode);
+
+            size_t pruned = 0;
+            if (mode == 'c')
+            {
+                size_t keep = 0;
+                std::cout << "Number of versions to keep: ";
+                std::cin >> keep;
+                pruned = manager.pruneHistory(keep);
+            }
+            else if (mode == 'a')
+            {
+                int days = 0;
+                std::cout << "Drop versions older than how many days: ";
+                std::cin >> days;
+                pruned = manager.pruneHistoryOlderThan(std::time(nullptr) - static_cast<std::time_t>(days) * 24 * 60 * 60);
+            }
+            std::cin.ignore();
+            std::cout << "Pruned " << pruned << " versions.\n";
+            break;
+        }
+        case 19:
         {
             std::cout << "Exiting...\n";
             return 0;
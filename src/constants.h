@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+
 constexpr const char* kLowerChars = "abcdefghijklmnopqrstuvwxyz";
 constexpr const char* kUpperChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-constexpr const char* kSpecialChars = "!@#$%^&*()-+=~`;:'?/";
\ No newline at end of file
+constexpr const char* kSpecialChars = "!@#$%^&*()-+=~`;:'?/";
+
+// Versions kept by the vault history before the oldest ones are pruned.
+constexpr size_t kMaxHistoryVersions = 1000;
@@ -1,38 +1,804 @@
 #include "file_handler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <utility>
 
-FileHandler::FileHandler(const std::string &filename) : filename(filename) {}
+#ifdef PM_HAVE_ZSTD
+#include <zstd.h>
+#endif
 
-bool FileHandler::loadPasswords(std::vector<Password> &passwords) {
-    passwords.clear();
+namespace {
+
+constexpr char kMagic[8] = {'P', 'W', 'M', 'V', 'A', 'U', 'L', 'T'};
+constexpr uint32_t kFormatVersion = 1;
+
+// Header page layout.
+constexpr size_t kVersionOffset = 8;
+constexpr size_t kPageSizeOffset = 12;
+constexpr size_t kPageCountOffset = 16;
+constexpr size_t kFlagsOffset = 20;
+constexpr uint32_t kFlagCompressed = 1;
+
+// Data page layout: slot count, start of free space (end of the slot
+// directory), end of free space (start of record bytes), then the slots.
+constexpr size_t kPageHeaderSize = 8;
+constexpr size_t kSlotSize = 4;
+constexpr size_t kMaxRecordSize = FileHandler::kPageSize - kPageHeaderSize - kSlotSize;
+
+// Compressed vaults tag every record with its type. Dictionary entries need a
+// few bytes of framing, so values stored there must leave room for it.
+constexpr char kPasswordRecord = 0;
+constexpr char kDictionaryRecord = 1;
+constexpr char kDictionaryZstdRecord = 2;
+constexpr size_t kDictionaryOverhead = 32;
+
+uint16_t readU16(const char *p) {
+    return static_cast<uint16_t>(static_cast<unsigned char>(p[0]) |
+                                 (static_cast<unsigned char>(p[1]) << 8));
+}
+
+void writeU16(char *p, uint16_t value) {
+    p[0] = static_cast<char>(value & 0xff);
+    p[1] = static_cast<char>(value >> 8);
+}
+
+uint32_t readU32(const char *p) {
+    return static_cast<uint32_t>(readU16(p)) | (static_cast<uint32_t>(readU16(p + 2)) << 16);
+}
+
+void writeU32(char *p, uint32_t value) {
+    writeU16(p, static_cast<uint16_t>(value & 0xffff));
+    writeU16(p + 2, static_cast<uint16_t>(value >> 16));
+}
+
+uint16_t slotCount(const char *page) { return readU16(page); }
+uint16_t freeStart(const char *page) { return readU16(page + 2); }
+uint16_t freeEnd(const char *page) { return readU16(page + 4); }
+uint16_t slotOffset(const char *page, uint16_t slot) { return readU16(page + kPageHeaderSize + slot * kSlotSize); }
+uint16_t slotLength(const char *page, uint16_t slot) { return readU16(page + kPageHeaderSize + slot * kSlotSize + 2); }
+
+bool slotDirectoryFits(const char *page) {
+    return kPageHeaderSize + slotCount(page) * kSlotSize <= FileHandler::kPageSize;
+}
+
+void setSlot(char *page, uint16_t slot, uint16_t offset, uint16_t length) {
+    writeU16(page + kPageHeaderSize + slot * kSlotSize, offset);
+    writeU16(page + kPageHeaderSize + slot * kSlotSize + 2, length);
+}
+
+void setPageHeader(char *page, uint16_t count, uint16_t end) {
+    writeU16(page, count);
+    writeU16(page + 2, static_cast<uint16_t>(kPageHeaderSize + count * kSlotSize));
+    writeU16(page + 4, end);
+}
+
+void appendField(std::string &out, const std::string &field) {
+    char len[2];
+    writeU16(len, static_cast<uint16_t>(field.size()));
+    out.append(len, 2);
+    out += field;
+}
+
+bool readField(const char *&pos, const char *end, std::string &field) {
+    if (end - pos < 2) return false;
+    uint16_t len = readU16(pos);
+    pos += 2;
+    if (end - pos < len) return false;
+    field.assign(pos, len);
+    pos += len;
+    return true;
+}
+
+std::string encodePlainRecord(const Password &pwd) {
+    std::string out;
+    for (const std::string *field : {&pwd.name, &pwd.password, &pwd.category, &pwd.website, &pwd.login}) {
+        appendField(out, *field);
+    }
+    return out;
+}
+
+bool decodeRecord(const char *data, size_t size, bool compressed,
+                  const StringDictionary &dictionary, Password &pwd) {
+    const char *pos = data;
+    const char *end = data + size;
+
+    if (!compressed) {
+        for (std::string *field : {&pwd.name, &pwd.password, &pwd.category, &pwd.website, &pwd.login}) {
+            if (!readField(pos, end, *field)) return false;
+        }
+        return pos == end;
+    }
+
+    if (pos == end || *pos++ != kPasswordRecord) return false;
+    for (std::string *field : {&pwd.name, &pwd.password, &pwd.category}) {
+        if (!readField(pos, end, *field)) return false;
+    }
+    for (std::string *field : {&pwd.website, &pwd.login}) {
+        uint32_t id = 0;
+        if (!readVarint(pos, end, id)) return false;
+        const std::string *value = dictionary.find(id);
+        if (!value) return false;
+        *field = *value;
+    }
+    return pos == end;
+}
+
+// Decodes only the field at index (name, password, category, website, login)
+// of a password record, skipping over the others.
+bool decodeField(const char *data, size_t size, bool compressed, const StringDictionary &dictionary,
+                 size_t index, std::string &value) {
+    const char *pos = data;
+    const char *end = data + size;
+    if (compressed && (pos == end || *pos++ != kPasswordRecord)) return false;
+
+    size_t plainFields = compressed ? 3 : 5;
+    for (size_t i = 0; i < plainFields; ++i) {
+        if (end - pos < 2) return false;
+        uint16_t len = readU16(pos);
+        if (end - pos - 2 < len) return false;
+        if (i == index) {
+            value.assign(pos + 2, len);
+            return true;
+        }
+        pos += 2 + len;
+    }
+    for (size_t i = plainFields; i < 5; ++i) {
+        uint32_t id = 0;
+        if (!readVarint(pos, end, id)) return false;
+        if (i == index) {
+            const std::string *found = dictionary.find(id);
+            if (!found) return false;
+            value = *found;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isDictionaryRecord(const char *data, size_t size) {
+    return size > 0 && (data[0] == kDictionaryRecord || data[0] == kDictionaryZstdRecord);
+}
+
+std::string encodeDictionaryRecord(const std::string &block) {
+#ifdef PM_HAVE_ZSTD
+    std::string packed(ZSTD_compressBound(block.size()), '\0');
+    size_t packedSize = ZSTD_compress(&packed[0], packed.size(), block.data(), block.size(), 3);
+    if (!ZSTD_isError(packedSize) && packedSize + 6 < block.size()) {
+        std::string out(1, kDictionaryZstdRecord);
+        appendVarint(out, static_cast<uint32_t>(block.size()));
+        out.append(packed, 0, packedSize);
+        return out;
+    }
+#endif
+    return std::string(1, kDictionaryRecord) + block;
+}
+
+bool decodeDictionaryRecord(const char *data, size_t size,
+                            std::vector<std::pair<uint32_t, std::string>> &entries) {
+    if (size == 0) return false;
+    if (data[0] == kDictionaryRecord) {
+        return StringDictionary::decodeBlock(data + 1, size - 1, entries);
+    }
+#ifdef PM_HAVE_ZSTD
+    if (data[0] == kDictionaryZstdRecord) {
+        const char *pos = data + 1;
+        uint32_t rawSize = 0;
+        if (!readVarint(pos, data + size, rawSize) || rawSize > FileHandler::kPageSize) return false;
+        std::string block(rawSize, '\0');
+        size_t result = ZSTD_decompress(&block[0], block.size(), pos, data + size - pos);
+        if (ZSTD_isError(result) || result != rawSize) return false;
+        return StringDictionary::decodeBlock(block.data(), block.size(), entries);
+    }
+#endif
+    return false;
+}
+
+// Adds every dictionary block of a compressed vault image to the dictionary.
+// Returns false when a block is malformed or conflicts with an earlier one.
+bool readDictionary(const char *content, size_t pageCount, StringDictionary &dictionary,
+                    std::vector<std::string> *problems) {
+    bool ok = true;
+    for (uint32_t p = 1; p < pageCount; ++p) {
+        const char *page = content + p * FileHandler::kPageSize;
+        if (!slotDirectoryFits(page)) continue;
+        for (uint16_t s = 0; s < slotCount(page); ++s) {
+            uint16_t offset = slotOffset(page, s);
+            uint16_t length = slotLength(page, s);
+            if (length == 0 || offset + length > FileHandler::kPageSize ||
+                !isDictionaryRecord(page + offset, length)) {
+                continue;
+            }
+            std::vector<std::pair<uint32_t, std::string>> entries;
+            bool valid = decodeDictionaryRecord(page + offset, length, entries);
+            for (const auto &entry : entries) {
+                valid = dictionary.add(entry.first, entry.second) && valid;
+            }
+            if (!valid) {
+                ok = false;
+                if (problems) {
+                    problems->push_back("page " + std::to_string(p) + ": slot " + std::to_string(s) +
+                                        " holds a malformed dictionary block");
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+bool readFile(const std::string &filename, std::string &content) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    std::streamoff size = file.is_open() ? static_cast<std::streamoff>(file.tellg()) : -1;
+    if (size < 0) return false;
+    content.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return static_cast<bool>(file.read(&content[0], static_cast<std::streamsize>(content.size())));
+}
 
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
+// The page count in the header is not checked: the file size is what counts,
+// and checkConsistency() reports a header that disagrees with it.
+bool validHeader(const std::string &content) {
+    return content.size() >= FileHandler::kPageSize && content.size() % FileHandler::kPageSize == 0 &&
+           std::equal(std::begin(kMagic), std::end(kMagic), content.begin()) &&
+           readU32(content.data() + kVersionOffset) == kFormatVersion &&
+           readU32(content.data() + kPageSizeOffset) == FileHandler::kPageSize;
+}
+
+uint16_t computeFreeSpace(const char *page) {
+    uint16_t count = slotCount(page);
+    size_t used = kPageHeaderSize + count * kSlotSize;
+    for (uint16_t s = 0; s < count; ++s) {
+        used += slotLength(page, s);
+    }
+    return used > FileHandler::kPageSize ? 0 : static_cast<uint16_t>(FileHandler::kPageSize - used);
+}
+
+void checkDataPage(const char *page, uint32_t pageNo, bool compressed,
+                   const StringDictionary &dictionary, std::vector<std::string> &problems) {
+    const std::string where = "page " + std::to_string(pageNo) + ": ";
+    uint16_t count = slotCount(page);
+    uint16_t start = freeStart(page);
+    uint16_t end = freeEnd(page);
+
+    if (!slotDirectoryFits(page)) {
+        problems.push_back(where + "slot directory overflows the page");
+        return;
+    }
+    if (start != kPageHeaderSize + count * kSlotSize) {
+        problems.push_back(where + "slot directory size does not match slot count");
+    }
+    if (start > end || end > FileHandler::kPageSize) {
+        problems.push_back(where + "invalid free space bounds");
+        return;
+    }
+
+    std::vector<std::pair<uint16_t, uint16_t>> extents;
+    for (uint16_t s = 0; s < count; ++s) {
+        uint16_t offset = slotOffset(page, s);
+        uint16_t length = slotLength(page, s);
+        if (length == 0) continue;
+
+        if (offset < end || offset + length > FileHandler::kPageSize) {
+            problems.push_back(where + "slot " + std::to_string(s) + " points outside the record area");
+            continue;
+        }
+        Password pwd;
+        if (!(compressed && isDictionaryRecord(page + offset, length)) &&
+            !decodeRecord(page + offset, length, compressed, dictionary, pwd)) {
+            problems.push_back(where + "slot " + std::to_string(s) + " holds a malformed record");
+        }
+        extents.emplace_back(offset, length);
+    }
+
+    std::sort(extents.begin(), extents.end());
+    for (size_t i = 1; i < extents.size(); ++i) {
+        if (extents[i - 1].first + extents[i - 1].second > extents[i].first) {
+            problems.push_back(where + "records overlap at offset " + std::to_string(extents[i].first));
+        }
+    }
+}
+
+}  // namespace
+
+FileHandler::FileHandler(const std::string &filename) : filename(filename) {
+    reset();
+}
+
+void FileHandler::reset() {
+    pages.assign(1, std::vector<char>(kPageSize, 0));
+    std::copy(std::begin(kMagic), std::end(kMagic), pages[0].begin());
+    writeU32(pages[0].data() + kVersionOffset, kFormatVersion);
+    writeU32(pages[0].data() + kPageSizeOffset, kPageSize);
+    writeU32(pages[0].data() + kPageCountOffset, 1);
+    writeU32(pages[0].data() + kFlagsOffset, compressed ? kFlagCompressed : 0);
+    freeSpace.assign(1, 0);
+    dictionary.clear();
+    pendingDictionary.clear();
+    dirty.assign(1, true);
+    damaged.assign(1, false);
+    rewriteAll = true;
+}
+
+bool FileHandler::loadPasswords(std::vector<Password> &passwords, std::vector<RecordId> &ids) {
+    std::string content;
+    if (!readFile(filename, content)) {
         std::cerr << "Error opening file for reading: " << filename << "\n";
+        passwords.clear();
+        ids.clear();
+        reset();
         return false;
     }
+    if (!loadImage(content, passwords, ids)) {
+        // Keep the unreadable file instead of overwriting it on the next flush.
+        keepOldFile = true;
+        return false;
+    }
+    keepOldFile = false;
+    return true;
+}
+
+bool FileHandler::loadImage(const std::string &content, std::vector<Password> &passwords,
+                            std::vector<RecordId> &ids) {
+    passwords.clear();
+    ids.clear();
 
-    Password pwd{};
-    while (file.read(reinterpret_cast<char*>(&pwd), sizeof(Password))) {
-        passwords.push_back(pwd);
+    if (!validHeader(content)) {
+        std::cerr << "Not a valid vault file: " << filename << "\n";
+        reset();
+        return false;
     }
 
-    file.close();
+    size_t count = content.size() / kPageSize;
+    compressed = (readU32(content.data() + kFlagsOffset) & kFlagCompressed) != 0;
+    bool countMatches = readU32(content.data() + kPageCountOffset) == count;
+    if (!countMatches) {
+        std::cerr << "Page count in header of " << filename << " does not match its size\n";
+    }
+    dictionary.clear();
+    pendingDictionary.clear();
+    if (compressed && !readDictionary(content.data(), count, dictionary, nullptr)) {
+        std::cerr << "Corrupted dictionary in vault file " << filename << "\n";
+    }
+
+    pages.assign(count, std::vector<char>(kPageSize));
+    freeSpace.assign(count, 0);
+    dirty.assign(count, false);
+    dirty[0] = !countMatches;  // the next flush writes the corrected count
+    damaged.assign(count, false);
+
+    for (uint32_t p = 0; p < count; ++p) {
+        std::copy_n(content.data() + p * kPageSize, kPageSize, pages[p].begin());
+        if (p == 0) continue;
+
+        // Damaged bytes stay as they are until an explicit vacuum: nothing is
+        // placed on a damaged page and it is never compacted. Loaded entries
+        // on it may still shrink in place or be removed.
+        const char *page = pages[p].data();
+        if (!slotDirectoryFits(page)) {
+            std::cerr << "Corrupted page in vault file " << filename << " (page " << p << ")\n";
+            damaged[p] = true;
+            continue;
+        }
+        for (uint16_t s = 0; s < slotCount(page); ++s) {
+            uint16_t length = slotLength(page, s);
+            if (length == 0) continue;
+            if (compressed && isDictionaryRecord(page + slotOffset(page, s), length)) continue;
+
+            Password pwd;
+            if (slotOffset(page, s) + length > kPageSize ||
+                !decodeRecord(page + slotOffset(page, s), length, compressed, dictionary, pwd)) {
+                std::cerr << "Corrupted record in vault file " << filename << " (page " << p
+                          << ", slot " << s << ")\n";
+                damaged[p] = true;
+                continue;
+            }
+            passwords.push_back(pwd);
+            ids.push_back(RecordId{p, s});
+        }
+        if (!damaged[p]) {
+            freeSpace[p] = computeFreeSpace(page);
+        }
+    }
+
+    rewriteAll = false;
     return true;
 }
 
-bool FileHandler::savePasswords(const std::vector<Password> &passwords) {
-    std::ofstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Error opening file for writing: " << filename << "\n";
+bool FileHandler::readField(std::string Password::*field,
+                            const std::function<void(const std::string &)> &visit) const {
+    std::string content;
+    if (!readFile(filename, content)) {
+        std::cerr << "Error opening file for reading: " << filename << "\n";
+        return false;
+    }
+    if (!validHeader(content)) {
+        std::cerr << "Not a valid vault file: " << filename << "\n";
         return false;
     }
 
+    const std::string Password::*fields[] = {&Password::name, &Password::password, &Password::category,
+                                             &Password::website, &Password::login};
+    size_t index = std::find(std::begin(fields), std::end(fields), field) - std::begin(fields);
+    size_t count = content.size() / kPageSize;
+    bool isCompressed = (readU32(content.data() + kFlagsOffset) & kFlagCompressed) != 0;
+
+    // Dictionary ids only stand in for websites and logins.
+    StringDictionary diskDictionary;
+    if (isCompressed && index >= 3 && !readDictionary(content.data(), count, diskDictionary, nullptr)) {
+        std::cerr << "Corrupted dictionary in vault file " << filename << "\n";
+    }
+
+    std::string value;
+    for (uint32_t p = 1; p < count; ++p) {
+        const char *page = content.data() + p * kPageSize;
+        if (!slotDirectoryFits(page)) continue;
+        for (uint16_t s = 0; s < slotCount(page); ++s) {
+            uint16_t offset = slotOffset(page, s);
+            uint16_t length = slotLength(page, s);
+            if (length == 0 || offset + length > kPageSize) continue;
+            if (isCompressed && isDictionaryRecord(page + offset, length)) continue;
+            if (decodeField(page + offset, length, isCompressed, diskDictionary, index, value)) {
+                visit(value);
+            }
+        }
+    }
+    return true;
+}
+
+bool FileHandler::savePasswords(const std::vector<Password> &passwords, std::vector<RecordId> &ids) {
+    return packPasswords(passwords, ids) && flush();
+}
+
+std::string FileHandler::saveImage(const std::vector<Password> &passwords, std::vector<RecordId> &ids) {
+    if (!packPasswords(passwords, ids)) {
+        return std::string();
+    }
+    writePendingDictionary();
+    writeU32(pages[0].data() + kPageCountOffset, static_cast<uint32_t>(pages.size()));
+
+    std::string image;
+    image.reserve(pages.size() * kPageSize);
+    for (const auto &page : pages) {
+        image.append(page.begin(), page.end());
+    }
+    return image;
+}
+
+bool FileHandler::packPasswords(const std::vector<Password> &passwords, std::vector<RecordId> &ids) {
+    // Check against the mode being written before anything is discarded, so
+    // a vault is never repacked without some of its entries.
     for (const auto &pwd : passwords) {
-        file.write(reinterpret_cast<const char*>(&pwd), sizeof(Password));
+        if (!fitsInPage(pwd, compressed)) {
+            std::cerr << "Record too large to store: " << pwd.name << "\n";
+            return false;
+        }
+    }
+
+    reset();
+    ids.clear();
+
+    std::vector<std::string> records;
+    records.reserve(passwords.size());
+    for (const auto &pwd : passwords) {
+        records.push_back(encodeRecord(pwd));
+    }
+    writePendingDictionary();
+
+    for (const std::string &record : records) {
+        uint32_t page = static_cast<uint32_t>(pages.size() - 1);
+        if (page == 0 || freeSpace[page] < record.size() + kSlotSize) {
+            page = appendPage();
+        }
+        uint16_t slot = slotCount(pages[page].data());
+        placeRecord(page, slot, record);
+        ids.push_back(RecordId{page, slot});
+    }
+    return true;
+}
+
+bool FileHandler::insertRecord(const Password &password, RecordId &id) {
+    if (!fitsInPage(password)) {
+        std::cerr << "Record too large to store: " << password.name << "\n";
+        return false;
+    }
+    id = insertRaw(encodeRecord(password));
+    return true;
+}
+
+bool FileHandler::updateRecord(RecordId &id, const Password &password) {
+    if (id.page == 0 || id.page >= pages.size()) return false;
+    char *page = pages[id.page].data();
+    if (id.slot >= slotCount(page) || slotLength(page, id.slot) == 0) return false;
+    if (!fitsInPage(password)) {
+        std::cerr << "Record too large to store: " << password.name << "\n";
+        return false;
+    }
+
+    std::string record = encodeRecord(password);
+    uint16_t oldOffset = slotOffset(page, id.slot);
+    uint16_t oldLength = slotLength(page, id.slot);
+
+    if (record.size() <= oldLength) {
+        // Shrinking or same size: overwrite in place, compaction reclaims the tail.
+        std::copy(record.begin(), record.end(), page + oldOffset);
+        setSlot(page, id.slot, oldOffset, static_cast<uint16_t>(record.size()));
+        freeSpace[id.page] += oldLength - record.size();
+        markDirty(id.page);
+        return true;
+    }
+
+    if (!damaged[id.page] && freeSpace[id.page] + oldLength >= record.size()) {
+        setSlot(page, id.slot, 0, 0);
+        freeSpace[id.page] += oldLength;
+        placeRecord(id.page, id.slot, record);
+        return true;
+    }
+
+    removeRecord(id);
+    return insertRecord(password, id);
+}
+
+bool FileHandler::removeRecord(const RecordId &id) {
+    if (id.page == 0 || id.page >= pages.size()) return false;
+    char *page = pages[id.page].data();
+    uint16_t count = slotCount(page);
+    if (id.slot >= count || slotLength(page, id.slot) == 0) return false;
+
+    freeSpace[id.page] += slotLength(page, id.slot);
+    setSlot(page, id.slot, 0, 0);
+
+    // Trailing empty slots can be dropped without renumbering live records.
+    while (count > 0 && slotLength(page, count - 1) == 0) {
+        --count;
+        freeSpace[id.page] += kSlotSize;
+    }
+    setPageHeader(page, count, freeEnd(page));
+    markDirty(id.page);
+    return true;
+}
+
+bool FileHandler::flush() {
+    writePendingDictionary();
+    writeU32(pages[0].data() + kPageCountOffset, static_cast<uint32_t>(pages.size()));
+    lastFlushWrites = 0;
+
+    std::fstream file;
+    if (!rewriteAll) {
+        file.open(filename, std::ios::binary | std::ios::in | std::ios::out);
+        if (!file.is_open()) {
+            rewriteAll = true;
+        }
+    }
+    if (rewriteAll) {
+        if (keepOldFile) {
+            const std::string backup = filename + ".bak";
+            std::remove(backup.c_str());
+            if (std::rename(filename.c_str(), backup.c_str()) != 0) {
+                std::cerr << "Cannot move unreadable vault file aside: " << filename << "\n";
+                return false;
+            }
+            keepOldFile = false;
+        }
+        file.open(filename, std::ios::binary | std::ios::out | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file for writing: " << filename << "\n";
+            return false;
+        }
+    }
+
+    // The header goes last so that a crash while appending pages leaves the
+    // old page count behind, not one that promises pages never written.
+    for (size_t i = 1; i <= pages.size(); ++i) {
+        size_t p = i % pages.size();
+        if (!rewriteAll && !dirty[p]) continue;
+        if (p == 0) file.flush();
+        file.seekp(static_cast<std::streamoff>(p) * kPageSize);
+        file.write(pages[p].data(), kPageSize);
+        ++lastFlushWrites;
     }
 
     file.close();
+    if (file.fail()) {
+        std::cerr << "Error writing file: " << filename << "\n";
+        return false;
+    }
+    std::fill(dirty.begin(), dirty.end(), false);
+    rewriteAll = false;
     return true;
 }
+
+bool FileHandler::checkConsistency(std::vector<std::string> &problems) const {
+    size_t before = problems.size();
+
+    std::string content;
+    if (!readFile(filename, content)) {
+        problems.push_back("cannot open " + filename);
+        return false;
+    }
+
+    if (content.size() < kPageSize || content.size() % kPageSize != 0) {
+        problems.push_back("file size is not a multiple of the page size");
+        return false;
+    }
+    if (!std::equal(std::begin(kMagic), std::end(kMagic), content.begin())) {
+        problems.push_back("bad file header");
+        return false;
+    }
+    if (readU32(content.data() + kVersionOffset) != kFormatVersion) {
+        problems.push_back("unsupported format version");
+    }
+    if (readU32(content.data() + kPageSizeOffset) != kPageSize) {
+        problems.push_back("unexpected page size");
+        return false;
+    }
+    if (readU32(content.data() + kPageCountOffset) != content.size() / kPageSize) {
+        problems.push_back("page count in header does not match file size");
+    }
+
+    bool isCompressed = (readU32(content.data() + kFlagsOffset) & kFlagCompressed) != 0;
+    StringDictionary diskDictionary;
+    if (isCompressed) {
+        readDictionary(content.data(), content.size() / kPageSize, diskDictionary, &problems);
+    }
+    for (uint32_t p = 1; p < content.size() / kPageSize; ++p) {
+        checkDataPage(content.data() + p * kPageSize, p, isCompressed, diskDictionary, problems);
+    }
+    return problems.size() == before;
+}
+
+void FileHandler::setCompressed(bool compressed) {
+    this->compressed = compressed;
+}
+
+bool FileHandler::isCompressed() const {
+    return storageCompressed();
+}
+
+bool FileHandler::fitsInPage(const Password &password) const {
+    return fitsInPage(password, storageCompressed());
+}
+
+bool FileHandler::fitsInPage(const Password &password, bool compressed) {
+    size_t limit = compressed ? kMaxRecordSize - kDictionaryOverhead : kMaxRecordSize;
+    for (const std::string *field : {&password.name, &password.password, &password.category,
+                                     &password.website, &password.login}) {
+        if (field->size() > limit) return false;
+    }
+    return encodePlainRecord(password).size() <= limit;
+}
+
+size_t FileHandler::pageCount() const {
+    return pages.size();
+}
+
+size_t FileHandler::freeBytes() const {
+    size_t total = 0;
+    for (size_t p = 1; p < freeSpace.size(); ++p) {
+        if (!damaged[p]) total += freeSpace[p];
+    }
+    return total;
+}
+
+size_t FileHandler::lastFlushPageWrites() const {
+    return lastFlushWrites;
+}
+
+bool FileHandler::storageCompressed() const {
+    return (readU32(pages[0].data() + kFlagsOffset) & kFlagCompressed) != 0;
+}
+
+std::string FileHandler::encodeRecord(const Password &password) {
+    if (!storageCompressed()) {
+        return encodePlainRecord(password);
+    }
+    std::string out(1, kPasswordRecord);
+    appendField(out, password.name);
+    appendField(out, password.password);
+    appendField(out, password.category);
+    appendVarint(out, internValue(password.website));
+    appendVarint(out, internValue(password.login));
+    return out;
+}
+
+uint32_t FileHandler::internValue(const std::string &value) {
+    size_t before = dictionary.size();
+    uint32_t id = dictionary.intern(value);
+    if (dictionary.size() != before) {
+        pendingDictionary.push_back(id);
+    }
+    return id;
+}
+
+void FileHandler::writePendingDictionary() {
+    if (pendingDictionary.empty()) return;
+
+    // Leave room for the record type and the zstd size prefix.
+    for (const auto &block : dictionary.encodeBlocks(pendingDictionary, kMaxRecordSize - 8)) {
+        insertRaw(encodeDictionaryRecord(block));
+    }
+    pendingDictionary.clear();
+}
+
+RecordId FileHandler::insertRaw(const std::string &record) {
+    uint32_t page = findPageWithSpace(record.size() + kSlotSize);
+    if (page == 0) {
+        page = appendPage();
+    }
+    uint16_t slot = freeSlot(page);
+    placeRecord(page, slot, record);
+    return RecordId{page, slot};
+}
+
+uint32_t FileHandler::appendPage() {
+    pages.emplace_back(kPageSize, 0);
+    setPageHeader(pages.back().data(), 0, static_cast<uint16_t>(kPageSize));
+    freeSpace.push_back(static_cast<uint16_t>(kPageSize - kPageHeaderSize));
+    dirty.push_back(true);
+    damaged.push_back(false);
+    markDirty(0);
+    return static_cast<uint32_t>(pages.size() - 1);
+}
+
+uint32_t FileHandler::findPageWithSpace(size_t recordSize) const {
+    for (uint32_t p = 1; p < freeSpace.size(); ++p) {
+        if (!damaged[p] && freeSpace[p] >= recordSize) return p;
+    }
+    return 0;
+}
+
+uint16_t FileHandler::freeSlot(uint32_t page) const {
+    const char *data = pages[page].data();
+    uint16_t count = slotCount(data);
+    for (uint16_t s = 0; s < count; ++s) {
+        if (slotLength(data, s) == 0) return s;
+    }
+    return count;
+}
+
+void FileHandler::compactPage(uint32_t page) {
+    char *data = pages[page].data();
+    uint16_t count = slotCount(data);
+    std::vector<char> copy(pages[page]);
+
+    uint16_t end = static_cast<uint16_t>(kPageSize);
+    for (uint16_t s = 0; s < count; ++s) {
+        uint16_t length = slotLength(data, s);
+        if (length == 0) continue;
+        end -= length;
+        std::copy_n(copy.data() + slotOffset(data, s), length, data + end);
+        setSlot(data, s, end, length);
+    }
+    setPageHeader(data, count, end);
+    markDirty(page);
+}
+
+void FileHandler::placeRecord(uint32_t page, uint16_t slot, const std::string &record) {
+    char *data = pages[page].data();
+    uint16_t count = slotCount(data);
+    size_t newSlots = slot >= count ? slot + 1 - count : 0;
+    size_t needed = record.size() + newSlots * kSlotSize;
+
+    if (static_cast<size_t>(freeEnd(data) - freeStart(data)) < needed) {
+        compactPage(page);
+    }
+    if (newSlots > 0) {
+        for (uint16_t s = count; s <= slot; ++s) {
+            setSlot(data, s, 0, 0);
+        }
+        count = static_cast<uint16_t>(slot + 1);
+    }
+
+    uint16_t offset = static_cast<uint16_t>(freeEnd(data) - record.size());
+    std::copy(record.begin(), record.end(), data + offset);
+    setSlot(data, slot, offset, static_cast<uint16_t>(record.size()));
+    setPageHeader(data, count, offset);
+    freeSpace[page] -= static_cast<uint16_t>(needed);
+    markDirty(page);
+}
+
+void FileHandler::markDirty(uint32_t page) {
+    dirty[page] = true;
+}
@@ -1,15 +1,102 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include "password.h"
+#include "string_dictionary.h"
 
+// Location of a record inside the vault file: data page number and slot index.
+struct RecordId {
+    uint32_t page = 0;
+    uint16_t slot = 0;
+};
+
+// Stores passwords in a page-structured vault file.
+//
+// Page 0 is the file header. Every other page is a slotted page: a small page
+// header, a slot directory growing towards the end of the page and record
+// bytes growing backwards from the end. Pages are cached in memory and only
+// pages modified since the last flush() are written back to disk.
+//
+// In compressed mode website and login values are replaced by ids into a
+// shared string dictionary. The dictionary is persisted as front-coded blocks
+// stored in ordinary slots (zstd-compressed when available at build time);
+// new values are appended as small blocks on flush and vacuum repacks them.
 class FileHandler {
 public:
+    static constexpr uint32_t kPageSize = 4096;
+
     FileHandler(const std::string &filename);
-    bool loadPasswords(std::vector<Password> &passwords);
-    bool savePasswords(const std::vector<Password> &passwords);
+
+    // Undecodable records are skipped. Their pages are never compacted or
+    // given new records, so the damaged bytes stay as they are; entries that
+    // did load from such a page can still be edited in place or removed.
+    // Damage is reported by checkConsistency() and repaired by savePasswords().
+    // A file that cannot be loaded at all is moved to <file>.bak by the next
+    // flush() instead of being overwritten.
+    bool loadPasswords(std::vector<Password> &passwords, std::vector<RecordId> &ids);
+    // Rewrites the whole vault with densely packed pages (used for vacuum).
+    // Fails without changing anything if an entry does not fit in a page of
+    // the selected storage mode.
+    bool savePasswords(const std::vector<Password> &passwords, std::vector<RecordId> &ids);
+    // Same as loadPasswords()/savePasswords() but on an in-memory copy of the
+    // vault file; the file itself is neither read nor written. saveImage()
+    // returns an empty image when an entry does not fit.
+    bool loadImage(const std::string &image, std::vector<Password> &passwords, std::vector<RecordId> &ids);
+    std::string saveImage(const std::vector<Password> &passwords, std::vector<RecordId> &ids);
+    // Calls visit with one field of every entry, read straight from the vault
+    // file without caching its pages or decoding the other fields.
+    bool readField(std::string Password::*field, const std::function<void(const std::string &)> &visit) const;
+
+    bool insertRecord(const Password &password, RecordId &id);
+    // May move the record to another page, in which case id is updated.
+    bool updateRecord(RecordId &id, const Password &password);
+    bool removeRecord(const RecordId &id);
+    bool flush();
+
+    // Validates the vault file on disk, appending a description of every
+    // problem found. Returns true when the file is consistent.
+    bool checkConsistency(std::vector<std::string> &problems) const;
+
+    // Selects the storage mode used the next time the vault is rewritten with
+    // savePasswords(). Loading a vault adopts the mode it was written in.
+    void setCompressed(bool compressed);
+    bool isCompressed() const;
+
+    bool fitsInPage(const Password &password) const;
+    // Whether the entry fits in a page of the given storage mode.
+    static bool fitsInPage(const Password &password, bool compressed);
+    size_t pageCount() const;
+    size_t freeBytes() const;
+    size_t lastFlushPageWrites() const;
 
 private:
     std::string filename;
-};
\ No newline at end of file
+    std::vector<std::vector<char>> pages;
+    std::vector<uint16_t> freeSpace;  // free-space map: reclaimable bytes per page
+    std::vector<bool> dirty;
+    std::vector<bool> damaged;  // pages that failed to load; never compacted or given new records
+    bool rewriteAll = true;
+    bool keepOldFile = false;  // an unreadable vault file is moved to .bak before rewriting
+    size_t lastFlushWrites = 0;
+    bool compressed = false;
+    StringDictionary dictionary;
+    std::vector<uint32_t> pendingDictionary;  // ids not yet written to a page
+
+    void reset();
+    bool storageCompressed() const;
+    bool packPasswords(const std::vector<Password> &passwords, std::vector<RecordId> &ids);
+    std::string encodeRecord(const Password &password);
+    uint32_t internValue(const std::string &value);
+    void writePendingDictionary();
+    RecordId insertRaw(const std::string &record);
+    uint32_t appendPage();
+    uint32_t findPageWithSpace(size_t recordSize) const;
+    void compactPage(uint32_t page);
+    void placeRecord(uint32_t page, uint16_t slot, const std::string &record);
+    uint16_t freeSlot(uint32_t page) const;
+    void markDirty(uint32_t page);
+};
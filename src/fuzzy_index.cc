@@ -0,0 +1,193 @@
+#include "fuzzy_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <unordered_set>
+
+namespace {
+
+std::string toLower(const std::string &value) {
+    std::string result = value;
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+}  // namespace
+
+FuzzyIndex::FuzzyIndex(int maxDistance) : maxDistance(maxDistance) {}
+
+void FuzzyIndex::add(const std::string &term, const std::string &owner) {
+    if (term.empty()) return;
+    std::string text = toLower(term);
+
+    auto it = std::lower_bound(terms.begin(), terms.end(), text,
+                               [](const Term &t, const std::string &value) { return t.text < value; });
+    if (it != terms.end() && it->text == text) {
+        it->owners.push_back(owner);
+    } else {
+        heads.insert(heads.begin() + (it - terms.begin()), headOf(text));
+        terms.insert(it, Term{text, {owner}});
+    }
+}
+
+void FuzzyIndex::remove(const std::string &term, const std::string &owner) {
+    if (term.empty()) return;
+    std::string text = toLower(term);
+
+    auto it = std::lower_bound(terms.begin(), terms.end(), text,
+                               [](const Term &t, const std::string &value) { return t.text < value; });
+    if (it == terms.end() || it->text != text) return;
+
+    auto ownerIt = std::find(it->owners.begin(), it->owners.end(), owner);
+    if (ownerIt == it->owners.end()) return;
+    it->owners.erase(ownerIt);
+    if (it->owners.empty()) {
+        heads.erase(heads.begin() + (it - terms.begin()));
+        terms.erase(it);
+    }
+}
+
+void FuzzyIndex::assign(std::vector<std::pair<std::string, std::string>> entries) {
+    terms.clear();
+    heads.clear();
+    for (auto &entry : entries) {
+        entry.first = toLower(entry.first);
+    }
+    std::sort(entries.begin(), entries.end());
+
+    for (auto &entry : entries) {
+        if (entry.first.empty()) continue;
+        if (terms.empty() || terms.back().text != entry.first) {
+            heads.push_back(headOf(entry.first));
+            terms.push_back(Term{std::move(entry.first), {}});
+        }
+        terms.back().owners.push_back(std::move(entry.second));
+    }
+}
+
+void FuzzyIndex::clear() {
+    terms.clear();
+    heads.clear();
+}
+
+std::vector<FuzzyMatch> FuzzyIndex::search(const std::string &query, size_t limit) const {
+    std::vector<FuzzyMatch> results;
+    if (query.empty() || limit == 0) return results;
+    std::string text = toLower(query);
+    int maxEdits = allowedDistance(text.size());
+
+    // No term deeper than |query| + maxEdits can still match.
+    std::vector<std::vector<int>> rows(text.size() + maxEdits + 2, std::vector<int>(text.size() + 1));
+    for (size_t j = 0; j <= text.size(); ++j) rows[0][j] = static_cast<int>(j);
+
+    std::vector<Hit> hits;
+    collect(text, maxEdits, rows, 0, terms.size(), 0, hits);
+
+    std::sort(hits.begin(), hits.end(), [this](const Hit &a, const Hit &b) {
+        if (a.distance != b.distance) return a.distance < b.distance;
+        if (a.score != b.score) return a.score > b.score;
+        return terms[a.term].text < terms[b.term].text;
+    });
+
+    // Every owner of a term shares its score, so expand terms in rank order
+    // until enough distinct entries have been collected.
+    std::unordered_set<std::string> seen;
+    for (const Hit &hit : hits) {
+        std::vector<std::string> owners = terms[hit.term].owners;
+        std::sort(owners.begin(), owners.end());
+        for (const auto &owner : owners) {
+            if (!seen.insert(owner).second) continue;
+            results.push_back(FuzzyMatch{owner, terms[hit.term].text, hit.distance, hit.score});
+            if (results.size() == limit) return results;
+        }
+    }
+    return results;
+}
+
+uint64_t FuzzyIndex::headOf(const std::string &text) {
+    uint64_t head = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        head = head << 8 | (i < text.size() ? static_cast<unsigned char>(text[i]) : 0);
+    }
+    return head;
+}
+
+unsigned char FuzzyIndex::charAt(size_t term, size_t depth) const {
+    if (depth < 8) return static_cast<unsigned char>(heads[term] >> (56 - 8 * depth));
+    return static_cast<unsigned char>(terms[term].text[depth]);
+}
+
+int FuzzyIndex::allowedDistance(size_t queryLength) const {
+    if (queryLength <= 2) return 0;
+    if (queryLength <= 5) return std::min(1, maxDistance);
+    return maxDistance;
+}
+
+void FuzzyIndex::collect(const std::string &query, int maxEdits, std::vector<std::vector<int>> &rows,
+                         size_t lo, size_t hi, size_t depth, std::vector<Hit> &hits) const {
+    const std::vector<int> &row = rows[depth];
+
+    // The range shares its first depth characters; a term of exactly that
+    // length sorts first.
+    if (lo < hi && terms[lo].text.size() == depth) {
+        // Lengths further apart than maxEdits are outside the band below.
+        int distance = depth + maxEdits >= query.size() && query.size() + maxEdits >= depth
+                           ? row[query.size()]
+                           : maxEdits + 1;
+        if (distance <= maxEdits) {
+            double longest = static_cast<double>(std::max(query.size(), depth));
+            hits.push_back(Hit{lo, distance, 1.0 - distance / longest});
+        }
+        ++lo;
+    }
+    if (depth + 1 >= rows.size() || depth + 1 > query.size() + maxEdits) return;
+
+    while (lo < hi) {
+        // Find the end of this child's range by galloping from its start:
+        // most children are small, and this keeps probes close together.
+        const unsigned char c = charAt(lo, depth);
+        size_t inside = lo;
+        size_t probe = lo + 1;
+        for (size_t step = 2; probe < hi && charAt(probe, depth) <= c; step *= 2) {
+            inside = probe;
+            probe = lo + step;
+        }
+        size_t end = std::min(probe, hi);
+        while (end - inside > 1) {
+            size_t mid = inside + (end - inside) / 2;
+            if (charAt(mid, depth) <= c) {
+                inside = mid;
+            } else {
+                end = mid;
+            }
+        }
+
+        // Only cells within maxEdits of the diagonal can lead to a match. The
+        // cells just outside that band are set to a value that cannot, since
+        // the next row reads them.
+        const size_t first = depth + 1 > static_cast<size_t>(maxEdits) ? depth + 1 - maxEdits : 1;
+        const size_t last = std::min(query.size(), depth + 1 + maxEdits);
+        std::vector<int> &next = rows[depth + 1];
+        next[first - 1] = first == 1 ? static_cast<int>(depth + 1) : maxEdits + 1;
+        if (last < query.size()) next[last + 1] = maxEdits + 1;
+        int rowMin = next[first - 1];
+        for (size_t j = first; j <= last; ++j) {
+            int cost = static_cast<unsigned char>(query[j - 1]) == c ? 0 : 1;
+            next[j] = std::min({row[j] + 1, next[j - 1] + 1, row[j - 1] + cost});
+            if (depth > 0 && j > 1 && static_cast<unsigned char>(query[j - 2]) == c &&
+                static_cast<unsigned char>(query[j - 1]) == charAt(lo, depth - 1)) {
+                next[j] = std::min(next[j], rows[depth - 1][j - 2] + 1);
+            }
+            rowMin = std::min(rowMin, next[j]);
+        }
+        // A wrong first character uses up most of the budget: below it only
+        // one edit is allowed. Otherwise a two-edit search would descend
+        // into nearly every first-level branch of the trie.
+        int childEdits = depth == 0 && c != static_cast<unsigned char>(query[0]) ? std::min(maxEdits, 1) : maxEdits;
+        if (rowMin <= childEdits) {
+            collect(query, childEdits, rows, lo, end, depth + 1, hits);
+        }
+        lo = end;
+    }
+}
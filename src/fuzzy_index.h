@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct FuzzyMatch {
+    std::string name;   // owner entry name
+    std::string term;   // indexed term that matched the query
+    int distance = 0;   // edit distance between query and term
+    double score = 0;   // 1.0 for an exact match, lower for more edits
+};
+
+// Typo-tolerant term index. Terms are kept in a sorted array, which acts as an
+// implicit trie: all terms sharing a prefix form a contiguous range. A search
+// walks that trie while running the edit distance automaton of the query one
+// character per level, and abandons a whole range as soon as no term below it
+// can be within the allowed number of edits (adjacent transpositions count as
+// one edit). The allowance grows with the query: none for up to 2 characters,
+// one for up to 5 and maxDistance beyond that, so short queries stay cheap and
+// do not match most of the index. Terms whose first character differs from the
+// query's are matched with at most one edit, which keeps two-edit searches
+// from walking every branch near the root.
+class FuzzyIndex {
+public:
+    explicit FuzzyIndex(int maxDistance = 2);
+
+    // Terms are matched case-insensitively; owner is the entry name reported
+    // in results. A term may be added several times for the same owner.
+    void add(const std::string &term, const std::string &owner);
+    void remove(const std::string &term, const std::string &owner);
+    // Replaces the contents with (term, owner) pairs in a single sort.
+    void assign(std::vector<std::pair<std::string, std::string>> entries);
+    void clear();
+
+    std::vector<FuzzyMatch> search(const std::string &query, size_t limit) const;
+
+private:
+    struct Term {
+        std::string text;
+        std::vector<std::string> owners;
+    };
+    struct Hit {
+        size_t term;
+        int distance;
+        double score;
+    };
+
+    int maxDistance;
+    std::vector<Term> terms;  // sorted by text
+    // First 8 bytes of each term packed big-endian, parallel to terms. Child
+    // ranges near the root are found by probing this compact array instead of
+    // following every probe to its string.
+    std::vector<uint64_t> heads;
+
+    static uint64_t headOf(const std::string &text);
+    unsigned char charAt(size_t term, size_t depth) const;
+    int allowedDistance(size_t queryLength) const;
+    void collect(const std::string &query, int maxEdits, std::vector<std::vector<int>> &rows,
+                 size_t lo, size_t hi, size_t depth, std::vector<Hit> &hits) const;
+};
@@ -2,18 +2,77 @@
 #include "constants.h"
 
 #include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <ctime>
 #include <cctype>
+#include <iterator>
 #include <random>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+// Changing more entries than this at once rebuilds the search indexes.
+constexpr size_t kIndexRebuildThreshold = 16;
+
+// Fuzzy search terms for an entry: its name, the website host and the host
+// labels in front of the top-level domain (so "gihub" finds "github.com").
+std::vector<std::string> searchTerms(const Password& pwd) {
+    std::vector<std::string> terms{pwd.name};
+
+    std::string host = pwd.website;
+    size_t scheme = host.find("://");
+    if (scheme != std::string::npos) host.erase(0, scheme + 3);
+    host = host.substr(0, host.find_first_of("/?#:"));
+    if (host.compare(0, 4, "www.") == 0) host.erase(0, 4);
+    if (host.empty()) return terms;
+
+    terms.push_back(host);
+    size_t start = 0;
+    size_t dot;
+    while ((dot = host.find('.', start)) != std::string::npos) {
+        if (dot - start >= 3) terms.push_back(host.substr(start, dot - start));
+        start = dot + 1;
+    }
+    return terms;
+}
+
+std::string entryKey(const Password& pwd) {
+    std::string key;
+    for (const std::string* field : {&pwd.name, &pwd.password, &pwd.category, &pwd.website, &pwd.login}) {
+        key += std::to_string(field->size()) + ":" + *field;
+    }
+    return key;
+}
+
+void printPassword(const Password& pwd) {
+    std::cout << "Name: " << pwd.name << "\n"
+              << "Password: " << pwd.password << "\n"
+              << "Category: " << pwd.category << "\n"
+              << "Website: " << pwd.website << "\n"
+              << "Login: " << pwd.login << "\n\n";
+}
+
+std::string formatTime(std::time_t time) {
+    std::ostringstream out;
+    out << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S");
+    return out.str();
+}
+
+}  // namespace
 
 PasswordManager::PasswordManager(const std::string& filename)
-    : fileHandler(filename) {
+    : fileHandler(filename), history(filename + ".history") {
     load();
 }
 
 void PasswordManager::load() {
-    if (!fileHandler.loadPasswords(passwords)) {
+    if (!fileHandler.loadPasswords(passwords, recordIds)) {
         std::cout << "Password file could not be loaded or does not exist. Starting with empty list.\n";
     } else {
         // Load categories from passwords:
@@ -25,35 +84,207 @@ void PasswordManager::load() {
             }
         }
     }
+
+    rebuildIndexes();
+    categoryIndex.assign(categories);
+
+    loadHistory();
 }
 
-void PasswordManager::save() {
-    fileHandler.savePasswords(passwords);
+void PasswordManager::rebuildIndexes() {
+    std::vector<std::pair<std::string, std::string>> fuzzyTerms;
+    std::vector<std::string> names;
+    std::vector<std::string> websites;
+    for (const auto& pwd : passwords) {
+        for (const auto& term : searchTerms(pwd)) {
+            fuzzyTerms.emplace_back(term, pwd.name);
+        }
+        names.push_back(pwd.name);
+        websites.push_back(pwd.website);
+    }
+    fuzzyIndex.assign(std::move(fuzzyTerms));
+    nameIndex.assign(std::move(names));
+    websiteIndex.assign(std::move(websites));
 }
 
-void PasswordManager::addPassword(const Password& password) {
+void PasswordManager::loadHistory() {
+    // The history belongs to this vault only if its current version holds
+    // exactly the loaded entries; otherwise start a new one.
+    if (history.load()) {
+        std::unordered_map<std::string, std::vector<uint64_t>> ids;
+        history.current().entries.forEach([&ids](uint64_t id, const Password& pwd) {
+            ids[entryKey(pwd)].push_back(id);
+        });
+
+        entryIds.clear();
+        for (const auto& pwd : passwords) {
+            auto it = ids.find(entryKey(pwd));
+            if (it == ids.end() || it->second.empty()) break;
+            entryIds.push_back(it->second.back());
+            it->second.pop_back();
+        }
+        if (entryIds.size() == passwords.size() && history.current().entries.size() == passwords.size()) {
+            return;
+        }
+    }
+    history.reset(passwords, entryIds);
+}
+
+bool PasswordManager::save() {
+    return fileHandler.flush();
+}
+
+void PasswordManager::indexPassword(const Password& password) {
+    for (const auto& term : searchTerms(password)) {
+        fuzzyIndex.add(term, password.name);
+    }
+    nameIndex.add(password.name);
+    websiteIndex.add(password.website);
+}
+
+void PasswordManager::unindexPassword(const Password& password) {
+    for (const auto& term : searchTerms(password)) {
+        fuzzyIndex.remove(term, password.name);
+    }
+    nameIndex.remove(password.name);
+    websiteIndex.remove(password.website);
+}
+
+bool PasswordManager::insertEntry(const Password& password, uint64_t entryId, bool reindex) {
+    RecordId id;
+    if (!fileHandler.insertRecord(password, id)) {
+        return false;
+    }
     passwords.push_back(password);
+    recordIds.push_back(id);
+    entryIds.push_back(entryId);
+    if (reindex) {
+        indexPassword(password);
+    }
 
     // Add category if new and not empty
     if (!password.category.empty() &&
         std::find(categories.begin(), categories.end(), password.category) == categories.end()) {
         categories.push_back(password.category);
+        categoryIndex.add(password.category);
+    }
+    return true;
+}
+
+bool PasswordManager::updateAt(size_t index, const Password& password, bool reindex) {
+    if (!fileHandler.updateRecord(recordIds[index], password)) {
+        return false;
+    }
+    if (reindex) {
+        unindexPassword(passwords[index]);
+        indexPassword(password);
+    }
+    passwords[index] = password;
+
+    if (!password.category.empty() &&
+        std::find(categories.begin(), categories.end(), password.category) == categories.end()) {
+        categories.push_back(password.category);
+        categoryIndex.add(password.category);
     }
+    return true;
+}
+
+std::vector<EntryChange> PasswordManager::eraseWhere(const std::function<bool(size_t)>& doomed) {
+    std::vector<EntryChange> changes;
+    size_t kept = 0;
+    for (size_t i = 0; i < passwords.size(); ++i) {
+        // Entries from i on have not been moved yet, so doomed may look at them.
+        if (doomed(i)) {
+            fileHandler.removeRecord(recordIds[i]);
+            changes.push_back(EntryChange{entryIds[i], std::make_shared<const Password>(std::move(passwords[i])),
+                                          nullptr});
+            continue;
+        }
+        if (kept != i) {
+            passwords[kept] = std::move(passwords[i]);
+            recordIds[kept] = recordIds[i];
+            entryIds[kept] = entryIds[i];
+        }
+        ++kept;
+    }
+    passwords.resize(kept);
+    recordIds.resize(kept);
+    entryIds.resize(kept);
 
+    // Each index removal shifts a sorted array, so past a handful of entries
+    // rebuilding the indexes in one sort is cheaper.
+    if (changes.size() > kIndexRebuildThreshold) {
+        rebuildIndexes();
+    } else {
+        for (const auto& change : changes) {
+            unindexPassword(*change.before);
+        }
+    }
+    return changes;
+}
+
+bool PasswordManager::applyChanges(const std::vector<EntryChange>& changes, bool undoing) {
+    // The storage mode may have changed since, so check every entry first.
+    for (const auto& change : changes) {
+        const auto& value = undoing ? change.before : change.after;
+        if (value && !fileHandler.fitsInPage(*value)) {
+            std::cerr << "Entry too large for the current storage mode: " << value->name << "\n";
+            return false;
+        }
+    }
+
+    std::unordered_set<uint64_t> removed;
+    for (const auto& change : changes) {
+        if (!(undoing ? change.before : change.after)) removed.insert(change.id);
+    }
+    if (!removed.empty()) {
+        eraseWhere([this, &removed](size_t i) { return removed.count(entryIds[i]) > 0; });
+    }
+
+    // Locate entries by id once for the whole batch; like eraseWhere, a large
+    // batch rebuilds the indexes in one sort instead of updating them per entry.
+    std::unordered_map<uint64_t, size_t> positions;
+    for (size_t i = 0; i < entryIds.size(); ++i) {
+        positions.emplace(entryIds[i], i);
+    }
+    const bool reindex = changes.size() - removed.size() <= kIndexRebuildThreshold;
+    bool applied = true;
+    for (const auto& change : changes) {
+        const auto& value = undoing ? change.before : change.after;
+        if (!value) continue;
+        auto it = positions.find(change.id);
+        applied = it != positions.end() ? updateAt(it->second, *value, reindex)
+                                         : insertEntry(*value, change.id, reindex);
+        if (!applied) break;
+    }
+    if (!reindex) {
+        rebuildIndexes();
+    }
+    return applied;
+}
+
+bool PasswordManager::addPassword(const Password& password) {
+    uint64_t entryId = history.newEntryId();
+    if (!insertEntry(password, entryId, true)) {
+        return false;
+    }
     save();
+    history.commit("Add " + password.name,
+                   {EntryChange{entryId, nullptr, std::make_shared<const Password>(password)}});
+    return true;
 }
 
 bool PasswordManager::editPassword(const std::string& name, const Password& newPasswordData) {
-    for (auto& pwd : passwords) {
-        if (pwd.name == name) {
-            pwd = newPasswordData;
-
-            if (!pwd.category.empty() &&
-                std::find(categories.begin(), categories.end(), pwd.category) == categories.end()) {
-                categories.push_back(pwd.category);
+    for (size_t i = 0; i < passwords.size(); ++i) {
+        if (passwords[i].name == name) {
+            auto before = std::make_shared<const Password>(passwords[i]);
+            if (!updateAt(i, newPasswordData, true)) {
+                return false;
             }
 
             save();
+            history.commit("Edit " + name, {EntryChange{entryIds[i], before,
+                                                        std::make_shared<const Password>(newPasswordData)}});
             return true;
         }
     }
@@ -61,13 +292,12 @@ bool PasswordManager::editPassword(const std::string& name, const Password& newP
 }
 
 bool PasswordManager::removePassword(const std::string& name) {
-    auto it = std::remove_if(passwords.begin(), passwords.end(),
-                             [&name](const Password& pwd) { return pwd.name == name; });
-    if (it == passwords.end()) {
+    std::vector<EntryChange> changes = eraseWhere([this, &name](size_t i) { return passwords[i].name == name; });
+    if (changes.empty()) {
         return false;
     }
-    passwords.erase(it, passwords.end());
     save();
+    history.commit("Remove " + name, std::move(changes));
     return true;
 }
 
@@ -81,11 +311,7 @@ void PasswordManager::searchPasswords(const std::string& query) const {
             pwd.website.find(query) != std::string::npos ||
             pwd.login.find(query) != std::string::npos) {
 
-            std::cout << "Name: " << pwd.name << "\n"
-                      << "Password: " << pwd.password << "\n"
-                      << "Category: " << pwd.category << "\n"
-                      << "Website: " << pwd.website << "\n"
-                      << "Login: " << pwd.login << "\n\n";
+            printPassword(pwd);
             found = true;
         }
     }
@@ -94,6 +320,58 @@ void PasswordManager::searchPasswords(const std::string& query) const {
     }
 }
 
+std::vector<FuzzyMatch> PasswordManager::fuzzySearch(const std::string& query, size_t limit) const {
+    return fuzzyIndex.search(query, limit);
+}
+
+std::vector<std::string> PasswordManager::complete(CompletionField field, const std::string& prefix,
+                                                   size_t limit) const {
+    switch (field) {
+    case CompletionField::Name:
+        return nameIndex.complete(prefix, limit);
+    case CompletionField::Category:
+        return categoryIndex.complete(prefix, limit);
+    case CompletionField::Website:
+        return websiteIndex.complete(prefix, limit);
+    }
+    return {};
+}
+
+std::vector<std::string> PasswordManager::completeFromFile(const std::string& filename, CompletionField field,
+                                                           const std::string& prefix, size_t limit) {
+    if (limit == 0) return {};
+    std::string Password::*member = field == CompletionField::Name       ? &Password::name
+                                    : field == CompletionField::Category ? &Password::category
+                                                                         : &Password::website;
+    std::string key = prefix;
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    // Same order as PrefixIndex: by lowercase key, then by value. Only the
+    // first limit candidates are kept while scanning.
+    std::set<std::pair<std::string, std::string>> best;
+    FileHandler reader(filename);
+    reader.readField(member, [&](const std::string& value) {
+        if (value.empty() || value.size() < key.size()) return;
+        for (size_t i = 0; i < key.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(value[i])) != static_cast<unsigned char>(key[i])) return;
+        }
+        std::string valueKey = value;
+        std::transform(valueKey.begin(), valueKey.end(), valueKey.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        auto candidate = std::make_pair(std::move(valueKey), value);
+        if (best.size() == limit && !(candidate < *best.rbegin())) return;
+        best.insert(std::move(candidate));
+        if (best.size() > limit) best.erase(std::prev(best.end()));
+    });
+
+    std::vector<std::string> results;
+    for (const auto& item : best) {
+        results.push_back(item.second);
+    }
+    return results;
+}
+
 void PasswordManager::sortPasswords(const std::vector<std::string>& fields) {
     std::vector<Password> result = passwords;
 
@@ -117,11 +395,7 @@ void PasswordManager::sortPasswords(const std::vector<std::string>& fields) {
 
     std::cout << "Sorted passwords:\n";
     for (const auto& pwd : result) {
-        std::cout << "Name: " << pwd.name << "\n"
-                  << "Password: " << pwd.password << "\n"
-                  << "Category: " << pwd.category << "\n"
-                  << "Website: " << pwd.website << "\n"
-                  << "Login: " << pwd.login << "\n\n";
+        printPassword(pwd);
     }
 }
 
@@ -157,21 +431,28 @@ std::string PasswordManager::randomPassword(int length, bool upperCase, bool low
 void PasswordManager::addCategory(const std::string& category) {
     if (category.empty()) return;
 
-    if (std::find(categories.begin(), categories.end(), category) == categories.end())
+    if (std::find(categories.begin(), categories.end(), category) == categories.end()) {
         categories.push_back(category);
+        categoryIndex.add(category);
+    }
 }
 
 void PasswordManager::removeCategory(const std::string& category) {
     if (category.empty()) return;
 
-    auto itPwd = std::remove_if(passwords.begin(), passwords.end(),
-                                [&category](const Password& pwd) { return pwd.category == category; });
-    passwords.erase(itPwd, passwords.end());
+    std::vector<EntryChange> changes =
+        eraseWhere([this, &category](size_t i) { return passwords[i].category == category; });
 
     auto itCat = std::remove(categories.begin(), categories.end(), category);
-    categories.erase(itCat, categories.end());
+    if (itCat != categories.end()) {
+        categories.erase(itCat, categories.end());
+        categoryIndex.remove(category);
+    }
 
     save();
+    if (!changes.empty()) {
+        history.commit("Remove category " + category, std::move(changes));
+    }
 }
 
 void PasswordManager::printCategories() const {
@@ -184,3 +465,176 @@ void PasswordManager::printCategories() const {
 const std::vector<Password>& PasswordManager::getPasswords() const {
     return passwords;
 }
+
+bool PasswordManager::checkConsistency(std::vector<std::string>& problems) const {
+    return fileHandler.checkConsistency(problems);
+}
+
+bool PasswordManager::vacuum() {
+    return fileHandler.savePasswords(passwords, recordIds);
+}
+
+bool PasswordManager::setCompressedStorage(bool compressed) {
+    // Compressed records leave room for dictionary framing, so an entry that
+    // fits in plain storage may not fit after the switch.
+    for (const auto& pwd : passwords) {
+        if (!FileHandler::fitsInPage(pwd, compressed)) {
+            std::cerr << "Entry too large for " << (compressed ? "compressed" : "plain")
+                      << " storage: " << pwd.name << "\n";
+            return false;
+        }
+    }
+
+    bool previous = fileHandler.isCompressed();
+    fileHandler.setCompressed(compressed);
+    if (!fileHandler.savePasswords(passwords, recordIds)) {
+        fileHandler.setCompressed(previous);
+        return false;
+    }
+    return true;
+}
+
+bool PasswordManager::isCompressedStorage() const {
+    return fileHandler.isCompressed();
+}
+
+void PasswordManager::printCompressionReport() const {
+    using Clock = std::chrono::steady_clock;
+
+    struct Measurement {
+        size_t fileBytes = 0;
+        size_t dataBytes = 0;
+        double saveMs = 0;
+        double loadMs = 0;
+        bool stored = false;
+    };
+
+    // Both formats are encoded to and decoded from in-memory vault images so
+    // no plaintext copy of the vault is written to disk.
+    auto measure = [this](bool compressed) {
+        Measurement result;
+        const std::string label = "compression report";
+
+        FileHandler writer(label);
+        writer.setCompressed(compressed);
+        std::vector<RecordId> ids;
+        auto start = Clock::now();
+        std::string image = writer.saveImage(passwords, ids);
+        auto saved = Clock::now();
+        if (image.empty()) {
+            return result;
+        }
+
+        FileHandler reader(label);
+        std::vector<Password> loaded;
+        reader.loadImage(image, loaded, ids);
+        auto loadedAt = Clock::now();
+
+        result.fileBytes = image.size();
+        result.dataBytes = (reader.pageCount() - 1) * FileHandler::kPageSize - reader.freeBytes();
+        result.saveMs = std::chrono::duration<double, std::milli>(saved - start).count();
+        result.loadMs = std::chrono::duration<double, std::milli>(loadedAt - saved).count();
+        result.stored = true;
+        return result;
+    };
+
+    Measurement plain = measure(false);
+    Measurement packed = measure(true);
+
+    auto print = [](const char* label, const Measurement& m) {
+        std::cout << label;
+        if (!m.stored) {
+            std::cout << "not possible, some entries are too large for this format\n";
+            return;
+        }
+        std::cout << m.dataBytes << " data bytes, " << m.fileBytes << " file bytes, save " << m.saveMs
+                  << " ms, load " << m.loadMs << " ms\n";
+    };
+
+    std::cout << "Compression report for " << passwords.size() << " passwords:\n";
+    print("Plain:      ", plain);
+    print("Compressed: ", packed);
+    if (plain.stored && packed.stored && packed.dataBytes > 0) {
+        std::cout << "Compression ratio: " << static_cast<double>(plain.dataBytes) / packed.dataBytes << "\n";
+    }
+    std::cout << "Current storage mode: " << (isCompressedStorage() ? "compressed" : "plain") << "\n";
+}
+
+bool PasswordManager::undo() {
+    const VaultVersion* undone = history.undoTarget();
+    if (!undone) {
+        std::cout << "Nothing to undo.\n";
+        return false;
+    }
+    if (!applyChanges(undone->changes, true)) {
+        std::cerr << "Could not undo: " << undone->description << "\n";
+        return false;
+    }
+    history.undo();
+    // The cursor move is only logged once the vault itself is on disk.
+    return save() && history.flush();
+}
+
+bool PasswordManager::redo() {
+    const VaultVersion* redone = history.redoTarget();
+    if (!redone) {
+        std::cout << "Nothing to redo.\n";
+        return false;
+    }
+    if (!applyChanges(redone->changes, false)) {
+        std::cerr << "Could not redo: " << redone->description << "\n";
+        return false;
+    }
+    history.redo();
+    return save() && history.flush();
+}
+
+void PasswordManager::printHistory() const {
+    std::cout << "Vault versions:\n";
+    const VaultVersion& current = history.current();
+    for (const auto& version : history.allVersions()) {
+        std::cout << (version.number == current.number ? "* " : "  ")
+                  << version.number << "  " << formatTime(version.timestamp) << "  "
+                  << version.description << " (" << version.entries.size() << " entries)\n";
+    }
+}
+
+void PasswordManager::printEntryHistory(const std::string& name) const {
+    std::cout << "History of " << name << ":\n";
+    bool found = false;
+    for (const auto& version : history.allVersions()) {
+        for (const auto& change : version.changes) {
+            if ((!change.before || change.before->name != name) && (!change.after || change.after->name != name)) {
+                continue;
+            }
+            std::cout << "Version " << version.number << " (" << formatTime(version.timestamp) << "): "
+                      << version.description << "\n";
+            if (change.after) {
+                printPassword(*change.after);
+            } else {
+                std::cout << "Removed.\n\n";
+            }
+            found = true;
+        }
+    }
+    if (!found) {
+        std::cout << "No recorded changes.\n";
+    }
+}
+
+bool PasswordManager::viewAt(uint64_t version, PersistentEntryMap& view) const {
+    const VaultVersion* found = history.find(version);
+    if (!found) {
+        return false;
+    }
+    view = found->entries;
+    return true;
+}
+
+size_t PasswordManager::pruneHistory(size_t keepVersions) {
+    return history.pruneToCount(keepVersions);
+}
+
+size_t PasswordManager::pruneHistoryOlderThan(std::time_t cutoff) {
+    return history.pruneOlderThan(cutoff);
+}
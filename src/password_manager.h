@@ -1,20 +1,33 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <string>
 #include "password.h"
 #include "file_handler.h"
+#include "fuzzy_index.h"
+#include "prefix_index.h"
+#include "version_history.h"
 
 class PasswordManager
 {
 public:
     PasswordManager(const std::string &filename);
 
-    void addPassword(const Password &password);
+    bool addPassword(const Password &password);
     bool editPassword(const std::string &name, const Password &newPasswordData);
     bool removePassword(const std::string &name);
 
     void searchPasswords(const std::string &query) const;
+    // Typo-tolerant lookup over entry names and websites, best matches first.
+    std::vector<FuzzyMatch> fuzzySearch(const std::string &query, size_t limit) const;
+    // Values of the given field starting with prefix (case-insensitive).
+    std::vector<std::string> complete(CompletionField field, const std::string &prefix, size_t limit) const;
+    // Same as complete() but reads only the requested field straight from the
+    // vault file, without loading the vault, its indexes or its history. The
+    // indexes are not persisted, so this scans every entry: O(n) per call.
+    static std::vector<std::string> completeFromFile(const std::string &filename, CompletionField field,
+                                                     const std::string &prefix, size_t limit);
     void sortPasswords(const std::vector<std::string> &fields);
     bool isPasswordUsed(const std::string &password) const;
 
@@ -26,11 +39,47 @@ public:
 
     std::string randomPassword(int length, bool upperCase, bool lowerCase, bool specialChar) const;
 
+    bool checkConsistency(std::vector<std::string> &problems) const;
+    bool vacuum();
+
+    bool setCompressedStorage(bool compressed);
+    bool isCompressedStorage() const;
+    void printCompressionReport() const;
+
+    // Every add, edit and removal creates a new vault version.
+    bool undo();
+    bool redo();
+    void printHistory() const;
+    void printEntryHistory(const std::string &name) const;
+    // Read-only view of the vault as of the given version.
+    bool viewAt(uint64_t version, PersistentEntryMap &view) const;
+    size_t pruneHistory(size_t keepVersions);
+    size_t pruneHistoryOlderThan(std::time_t cutoff);
+
 private:
     std::vector<Password> passwords;
+    std::vector<RecordId> recordIds;  // vault location of passwords[i]
+    std::vector<uint64_t> entryIds;   // history id of passwords[i]
     FileHandler fileHandler;
     std::vector<std::string> categories;
+    FuzzyIndex fuzzyIndex;
+    PrefixIndex nameIndex;
+    PrefixIndex categoryIndex;
+    PrefixIndex websiteIndex;
+    VersionHistory history;
 
     void load();
-    void save();
+    void loadHistory();
+    bool save();
+    // reindex = false leaves the search indexes to a later rebuildIndexes().
+    bool insertEntry(const Password &password, uint64_t entryId, bool reindex);
+    bool updateAt(size_t index, const Password &password, bool reindex);
+    // Removes every entry whose index matches in one pass and returns the changes.
+    std::vector<EntryChange> eraseWhere(const std::function<bool(size_t)> &doomed);
+    void rebuildIndexes();
+    // Sets every entry in changes to its state before (undoing) or after the
+    // change. Nothing is modified if one of them no longer fits in a page.
+    bool applyChanges(const std::vector<EntryChange> &changes, bool undoing);
+    void indexPassword(const Password &password);
+    void unindexPassword(const Password &password);
 };
@@ -0,0 +1,106 @@
+#include "persistent_map.h"
+
+#include <utility>
+
+struct PersistentEntryMap::Node {
+    uint64_t key;
+    Value value;
+    NodePtr left;
+    NodePtr right;
+    size_t size;
+};
+
+namespace {
+
+// Heap priority derived from the key, so a key set always has the same shape.
+uint64_t priority(uint64_t key) {
+    key += 0x9e3779b97f4a7c15ULL;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+}
+
+}  // namespace
+
+PersistentEntryMap::PersistentEntryMap(NodePtr root) : root(std::move(root)) {}
+
+PersistentEntryMap PersistentEntryMap::set(uint64_t id, Value value) const {
+    return PersistentEntryMap(insertNode(root, id, value));
+}
+
+PersistentEntryMap PersistentEntryMap::erase(uint64_t id) const {
+    return PersistentEntryMap(eraseNode(root, id));
+}
+
+PersistentEntryMap::Value PersistentEntryMap::find(uint64_t id) const {
+    const Node *node = root.get();
+    while (node) {
+        if (id == node->key) return node->value;
+        node = id < node->key ? node->left.get() : node->right.get();
+    }
+    return nullptr;
+}
+
+size_t PersistentEntryMap::size() const {
+    return root ? root->size : 0;
+}
+
+void PersistentEntryMap::forEach(const std::function<void(uint64_t, const Password &)> &visit) const {
+    std::function<void(const Node *)> walk = [&](const Node *node) {
+        if (!node) return;
+        walk(node->left.get());
+        visit(node->key, *node->value);
+        walk(node->right.get());
+    };
+    walk(root.get());
+}
+
+PersistentEntryMap::NodePtr PersistentEntryMap::makeNode(uint64_t key, Value value, NodePtr left, NodePtr right) {
+    size_t size = 1 + (left ? left->size : 0) + (right ? right->size : 0);
+    return std::make_shared<const Node>(Node{key, std::move(value), std::move(left), std::move(right), size});
+}
+
+PersistentEntryMap::NodePtr PersistentEntryMap::insertNode(const NodePtr &node, uint64_t key, const Value &value) {
+    if (!node) return makeNode(key, value, nullptr, nullptr);
+    if (key == node->key) return makeNode(key, value, node->left, node->right);
+
+    if (key < node->key) {
+        NodePtr left = insertNode(node->left, key, value);
+        if (priority(left->key) > priority(node->key)) {
+            // Rotate right so the heap order on priorities holds.
+            NodePtr demoted = makeNode(node->key, node->value, left->right, node->right);
+            return makeNode(left->key, left->value, left->left, demoted);
+        }
+        return makeNode(node->key, node->value, left, node->right);
+    }
+
+    NodePtr right = insertNode(node->right, key, value);
+    if (priority(right->key) > priority(node->key)) {
+        NodePtr demoted = makeNode(node->key, node->value, node->left, right->left);
+        return makeNode(right->key, right->value, demoted, right->right);
+    }
+    return makeNode(node->key, node->value, node->left, right);
+}
+
+PersistentEntryMap::NodePtr PersistentEntryMap::eraseNode(const NodePtr &node, uint64_t key) {
+    if (!node) return node;
+    if (key == node->key) return mergeNodes(node->left, node->right);
+
+    if (key < node->key) {
+        NodePtr left = eraseNode(node->left, key);
+        if (left == node->left) return node;
+        return makeNode(node->key, node->value, left, node->right);
+    }
+    NodePtr right = eraseNode(node->right, key);
+    if (right == node->right) return node;
+    return makeNode(node->key, node->value, node->left, right);
+}
+
+PersistentEntryMap::NodePtr PersistentEntryMap::mergeNodes(const NodePtr &a, const NodePtr &b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (priority(a->key) > priority(b->key)) {
+        return makeNode(a->key, a->value, a->left, mergeNodes(a->right, b));
+    }
+    return makeNode(b->key, b->value, mergeNodes(a, b->left), b->right);
+}
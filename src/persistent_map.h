@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include "password.h"
+
+// Immutable map from entry id to password, implemented as a treap with path
+// copying. set() and erase() return a new map that shares every untouched
+// node with the original, so each update allocates O(log n) nodes and old
+// versions stay valid for as long as someone holds them.
+class PersistentEntryMap {
+public:
+    using Value = std::shared_ptr<const Password>;
+
+    PersistentEntryMap() = default;
+
+    PersistentEntryMap set(uint64_t id, Value value) const;
+    PersistentEntryMap erase(uint64_t id) const;
+    Value find(uint64_t id) const;
+    size_t size() const;
+
+    // Visits entries in id order.
+    void forEach(const std::function<void(uint64_t, const Password &)> &visit) const;
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    NodePtr root;
+
+    explicit PersistentEntryMap(NodePtr root);
+
+    static NodePtr makeNode(uint64_t key, Value value, NodePtr left, NodePtr right);
+    static NodePtr insertNode(const NodePtr &node, uint64_t key, const Value &value);
+    static NodePtr eraseNode(const NodePtr &node, uint64_t key);
+    static NodePtr mergeNodes(const NodePtr &a, const NodePtr &b);
+};
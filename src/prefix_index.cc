@@ -0,0 +1,87 @@
+#include "prefix_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+namespace {
+
+std::string toLower(const std::string &value) {
+    std::string result = value;
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+}  // namespace
+
+std::vector<PrefixIndex::Entry>::iterator PrefixIndex::find(const std::string &key, const std::string &value) {
+    return std::lower_bound(entries.begin(), entries.end(), std::make_pair(&key, &value),
+                            [](const Entry &e, const std::pair<const std::string *, const std::string *> &target) {
+                                if (e.key != *target.first) return e.key < *target.first;
+                                return e.value < *target.second;
+                            });
+}
+
+void PrefixIndex::add(const std::string &value) {
+    if (value.empty()) return;
+    std::string key = toLower(value);
+
+    auto it = find(key, value);
+    if (it != entries.end() && it->value == value) {
+        ++it->count;
+    } else {
+        entries.insert(it, Entry{std::move(key), value, 1});
+    }
+}
+
+void PrefixIndex::remove(const std::string &value) {
+    if (value.empty()) return;
+
+    auto it = find(toLower(value), value);
+    if (it == entries.end() || it->value != value) return;
+    if (--it->count == 0) {
+        entries.erase(it);
+    }
+}
+
+void PrefixIndex::assign(std::vector<std::string> values) {
+    entries.clear();
+    values.erase(std::remove(values.begin(), values.end(), std::string()), values.end());
+
+    std::vector<std::pair<std::string, std::string>> keyed;
+    keyed.reserve(values.size());
+    for (auto &value : values) {
+        keyed.emplace_back(toLower(value), std::move(value));
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    for (auto &item : keyed) {
+        if (!entries.empty() && entries.back().value == item.second) {
+            ++entries.back().count;
+        } else {
+            entries.push_back(Entry{std::move(item.first), std::move(item.second), 1});
+        }
+    }
+}
+
+void PrefixIndex::clear() {
+    entries.clear();
+}
+
+std::vector<std::string> PrefixIndex::complete(const std::string &prefix, size_t limit) const {
+    std::vector<std::string> results;
+    std::string key = toLower(prefix);
+
+    auto it = std::lower_bound(entries.begin(), entries.end(), key,
+                               [](const Entry &e, const std::string &target) { return e.key < target; });
+    for (; it != entries.end() && results.size() < limit; ++it) {
+        if (it->key.compare(0, key.size(), key) != 0) break;
+        results.push_back(it->value);
+    }
+    return results;
+}
+
+size_t PrefixIndex::size() const {
+    return entries.size();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum class CompletionField { Name, Category, Website };
+
+// Case-insensitive autocomplete over a multiset of values. Values are kept in
+// a sorted array keyed by their lowercase form, so the completions for a
+// prefix are one binary search followed by a scan of at most limit entries.
+class PrefixIndex {
+public:
+    void add(const std::string &value);
+    void remove(const std::string &value);
+    // Replaces the contents with the given values in a single sort.
+    void assign(std::vector<std::string> values);
+    void clear();
+
+    // Returns up to limit distinct values starting with prefix, in key order.
+    std::vector<std::string> complete(const std::string &prefix, size_t limit) const;
+    size_t size() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::string value;
+        size_t count;
+    };
+
+    std::vector<Entry> entries;
+
+    std::vector<Entry>::iterator find(const std::string &key, const std::string &value);
+};
@@ -0,0 +1,141 @@
+#include "string_dictionary.h"
+
+#include <algorithm>
+
+void appendVarint(std::string &out, uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool readVarint(const char *&pos, const char *end, uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos == end) return false;
+        unsigned char byte = static_cast<unsigned char>(*pos++);
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+StringDictionary::StringDictionary() {
+    clear();
+}
+
+uint32_t StringDictionary::intern(const std::string &value) {
+    auto it = ids.find(value);
+    if (it != ids.end()) return it->second;
+
+    uint32_t id = static_cast<uint32_t>(values.size());
+    values.push_back(value);
+    ids.emplace(value, id);
+    return id;
+}
+
+bool StringDictionary::add(uint32_t id, const std::string &value) {
+    if (id == 0) return value.empty();
+
+    auto it = ids.find(value);
+    if (it != ids.end()) return it->second == id;
+    if (id < values.size() && !values[id].empty()) return false;
+
+    if (id >= values.size()) values.resize(id + 1);
+    values[id] = value;
+    ids.emplace(value, id);
+    return true;
+}
+
+const std::string *StringDictionary::find(uint32_t id) const {
+    if (id >= values.size()) return nullptr;
+    if (id != 0 && values[id].empty()) return nullptr;
+    return &values[id];
+}
+
+void StringDictionary::clear() {
+    values.assign(1, std::string());
+    ids.clear();
+    ids.emplace(std::string(), 0);
+}
+
+size_t StringDictionary::size() const {
+    return ids.size() - 1;
+}
+
+std::vector<std::string> StringDictionary::encodeBlocks(std::vector<uint32_t> entryIds,
+                                                        size_t maxBlockSize) const {
+    std::sort(entryIds.begin(), entryIds.end(),
+              [this](uint32_t a, uint32_t b) { return values[a] < values[b]; });
+
+    std::vector<std::string> blocks;
+    std::string body;
+    uint32_t count = 0;
+    const std::string *previous = nullptr;
+
+    auto finishBlock = [&]() {
+        if (count == 0) return;
+        std::string block;
+        appendVarint(block, count);
+        blocks.push_back(block + body);
+        body.clear();
+        count = 0;
+        previous = nullptr;
+    };
+
+    for (uint32_t id : entryIds) {
+        if (id == 0 || id >= values.size()) continue;
+        const std::string &value = values[id];
+
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            size_t shared = 0;
+            if (previous) {
+                size_t limit = std::min(previous->size(), value.size());
+                while (shared < limit && (*previous)[shared] == value[shared]) ++shared;
+            }
+            std::string entry;
+            appendVarint(entry, id);
+            appendVarint(entry, static_cast<uint32_t>(shared));
+            appendVarint(entry, static_cast<uint32_t>(value.size() - shared));
+            entry.append(value, shared, std::string::npos);
+
+            // Leave room for the count prefix (at most 5 bytes).
+            if (count > 0 && body.size() + entry.size() + 5 > maxBlockSize) {
+                finishBlock();
+                continue;
+            }
+            body += entry;
+            ++count;
+            previous = &value;
+            break;
+        }
+    }
+    finishBlock();
+    return blocks;
+}
+
+bool StringDictionary::decodeBlock(const char *data, size_t size,
+                                   std::vector<std::pair<uint32_t, std::string>> &entries) {
+    const char *pos = data;
+    const char *end = data + size;
+    uint32_t count = 0;
+    if (!readVarint(pos, end, count)) return false;
+
+    std::string previous;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t id = 0, shared = 0, suffix = 0;
+        if (!readVarint(pos, end, id) || !readVarint(pos, end, shared) ||
+            !readVarint(pos, end, suffix)) {
+            return false;
+        }
+        if (shared > previous.size() || suffix > static_cast<size_t>(end - pos)) return false;
+
+        std::string value = previous.substr(0, shared);
+        value.append(pos, suffix);
+        pos += suffix;
+        entries.emplace_back(id, value);
+        previous = value;
+    }
+    return pos == end;
+}
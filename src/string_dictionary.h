@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+void appendVarint(std::string &out, uint32_t value);
+bool readVarint(const char *&pos, const char *end, uint32_t &value);
+
+// Maps repeated string values (websites, logins) to small integer ids.
+// Id 0 is always the empty string and is never stored.
+class StringDictionary {
+public:
+    StringDictionary();
+
+    uint32_t intern(const std::string &value);
+    bool add(uint32_t id, const std::string &value);
+    const std::string *find(uint32_t id) const;
+    void clear();
+    size_t size() const;
+
+    // Front-codes the given entries sorted by value: each string stores only the
+    // length of the prefix it shares with its predecessor plus the remaining
+    // suffix. Output is split into blocks of at most maxBlockSize bytes.
+    std::vector<std::string> encodeBlocks(std::vector<uint32_t> ids, size_t maxBlockSize) const;
+    static bool decodeBlock(const char *data, size_t size,
+                            std::vector<std::pair<uint32_t, std::string>> &entries);
+
+private:
+    std::vector<std::string> values;
+    std::unordered_map<std::string, uint32_t> ids;
+};
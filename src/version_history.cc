@@ -0,0 +1,383 @@
+#include "version_history.h"
+#include "constants.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'W', 'M', 'H', 'I', 'S', 'T', '1'};
+
+// Every log record is a type byte, a 32-bit payload length and the payload,
+// so a record torn by a crash at the end of the log can be detected; it is
+// dropped by rewriting the log before the next record is written.
+constexpr char kBaseRecord = 'B';
+constexpr char kCommitRecord = 'C';
+constexpr char kUndoRecord = 'U';
+constexpr char kRedoRecord = 'R';
+constexpr size_t kRecordHeaderSize = 5;
+
+constexpr unsigned char kHasBefore = 1;
+constexpr unsigned char kHasAfter = 2;
+
+void putU32(std::string &out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+void putU64(std::string &out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) out += static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+void putString(std::string &out, const std::string &value) {
+    putU32(out, static_cast<uint32_t>(value.size()));
+    out += value;
+}
+
+void putPassword(std::string &out, const Password &pwd) {
+    for (const std::string *field : {&pwd.name, &pwd.password, &pwd.category, &pwd.website, &pwd.login}) {
+        putString(out, *field);
+    }
+}
+
+std::string frame(char type, const std::string &payload) {
+    std::string out(1, type);
+    putU32(out, static_cast<uint32_t>(payload.size()));
+    return out + payload;
+}
+
+struct Reader {
+    const char *pos;
+    const char *end;
+    bool ok = true;
+
+    uint64_t number(int bytes) {
+        if (end - pos < bytes) {
+            ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(pos[i])) << (8 * i);
+        }
+        pos += bytes;
+        return value;
+    }
+
+    std::string string() {
+        uint64_t size = number(4);
+        if (!ok || static_cast<uint64_t>(end - pos) < size) {
+            ok = false;
+            return std::string();
+        }
+        std::string value(pos, size);
+        pos += size;
+        return value;
+    }
+
+    Password password() {
+        Password pwd;
+        for (std::string *field : {&pwd.name, &pwd.password, &pwd.category, &pwd.website, &pwd.login}) {
+            *field = string();
+        }
+        return pwd;
+    }
+};
+
+std::string encodeBase(const VaultVersion &version, uint64_t nextEntryId) {
+    std::string out;
+    putU64(out, version.number);
+    putU64(out, static_cast<uint64_t>(version.timestamp));
+    putString(out, version.description);
+    putU64(out, nextEntryId);
+    putU32(out, static_cast<uint32_t>(version.entries.size()));
+    version.entries.forEach([&out](uint64_t id, const Password &pwd) {
+        putU64(out, id);
+        putPassword(out, pwd);
+    });
+    return out;
+}
+
+std::string encodeCommit(const VaultVersion &version) {
+    std::string out;
+    putU64(out, version.number);
+    putU64(out, static_cast<uint64_t>(version.timestamp));
+    putString(out, version.description);
+    putU32(out, static_cast<uint32_t>(version.changes.size()));
+    for (const auto &change : version.changes) {
+        putU64(out, change.id);
+        out += static_cast<char>((change.before ? kHasBefore : 0) | (change.after ? kHasAfter : 0));
+        if (change.before) putPassword(out, *change.before);
+        if (change.after) putPassword(out, *change.after);
+    }
+    return out;
+}
+
+}  // namespace
+
+VersionHistory::VersionHistory(const std::string &filename) : filename(filename) {
+    VaultVersion base;
+    base.timestamp = std::time(nullptr);
+    base.description = "Initial version";
+    versions.push_back(base);
+}
+
+bool VersionHistory::load() {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    if (content.size() < sizeof(kMagic) || !std::equal(std::begin(kMagic), std::end(kMagic), content.begin())) {
+        std::cerr << "Not a valid history file: " << filename << "\n";
+        return false;
+    }
+
+    std::deque<VaultVersion> loaded;
+    versions.swap(loaded);
+    currentIndex = 0;
+    nextEntryId = 1;
+
+    size_t pos = sizeof(kMagic);
+    size_t validEnd = pos;
+    while (content.size() - pos >= kRecordHeaderSize) {
+        char type = content[pos];
+        Reader header{content.data() + pos + 1, content.data() + content.size()};
+        size_t length = static_cast<size_t>(header.number(4));
+        if (content.size() - pos - kRecordHeaderSize < length) break;
+
+        Reader reader{content.data() + pos + kRecordHeaderSize, content.data() + pos + kRecordHeaderSize + length};
+        pos += kRecordHeaderSize + length;
+
+        if (type == kBaseRecord && versions.empty()) {
+            VaultVersion base;
+            base.number = reader.number(8);
+            base.timestamp = static_cast<std::time_t>(reader.number(8));
+            base.description = reader.string();
+            nextEntryId = reader.number(8);
+            uint64_t count = reader.number(4);
+            for (uint64_t i = 0; i < count && reader.ok; ++i) {
+                uint64_t id = reader.number(8);
+                Password pwd = reader.password();
+                base.entries = base.entries.set(id, std::make_shared<const Password>(pwd));
+            }
+            if (!reader.ok) break;
+            versions.push_back(std::move(base));
+        } else if (type == kCommitRecord && !versions.empty()) {
+            VaultVersion version;
+            version.number = reader.number(8);
+            version.timestamp = static_cast<std::time_t>(reader.number(8));
+            version.description = reader.string();
+            uint64_t count = reader.number(4);
+            for (uint64_t i = 0; i < count && reader.ok; ++i) {
+                EntryChange change;
+                change.id = reader.number(8);
+                uint64_t flags = reader.number(1);
+                if (flags & kHasBefore) change.before = std::make_shared<const Password>(reader.password());
+                if (flags & kHasAfter) change.after = std::make_shared<const Password>(reader.password());
+                version.changes.push_back(change);
+            }
+            if (!reader.ok) break;
+            applyCommit(std::move(version));
+        } else if (type == kUndoRecord && !versions.empty()) {
+            if (currentIndex > 0) --currentIndex;
+        } else if (type == kRedoRecord && !versions.empty()) {
+            if (currentIndex + 1 < versions.size()) ++currentIndex;
+        } else {
+            break;
+        }
+        validEnd = pos;
+    }
+
+    if (versions.empty()) {
+        versions.swap(loaded);
+        std::cerr << "History file has no base version: " << filename << "\n";
+        return false;
+    }
+    if (validEnd != content.size()) {
+        std::cerr << "Ignoring damaged records at the end of history file " << filename << "\n";
+    }
+    logCurrent = validEnd == content.size();
+    replaceLog = false;
+    pendingRecords.clear();
+    return true;
+}
+
+void VersionHistory::reset(const std::vector<Password> &passwords, std::vector<uint64_t> &ids) {
+    VaultVersion base;
+    base.timestamp = std::time(nullptr);
+    base.description = "Initial version";
+
+    nextEntryId = 1;
+    ids.clear();
+    for (const auto &pwd : passwords) {
+        ids.push_back(nextEntryId);
+        base.entries = base.entries.set(nextEntryId++, std::make_shared<const Password>(pwd));
+    }
+
+    versions.clear();
+    versions.push_back(std::move(base));
+    currentIndex = 0;
+    logCurrent = false;
+    replaceLog = true;
+    pendingRecords.clear();
+}
+
+bool VersionHistory::commit(const std::string &description, std::vector<EntryChange> changes) {
+    VaultVersion version;
+    version.number = versions[currentIndex].number + 1;
+    version.timestamp = std::time(nullptr);
+    version.description = description;
+    version.changes = std::move(changes);
+    applyCommit(std::move(version));
+
+    if (versions.size() > 2 * kMaxHistoryVersions) {
+        pruneToCount(kMaxHistoryVersions);
+        return true;
+    }
+    return append(frame(kCommitRecord, encodeCommit(versions.back())));
+}
+
+const VaultVersion *VersionHistory::undo() {
+    if (currentIndex == 0) return nullptr;
+    pendingRecords += frame(kUndoRecord, std::string());
+    return &versions[currentIndex--];
+}
+
+const VaultVersion *VersionHistory::redo() {
+    if (currentIndex + 1 >= versions.size()) return nullptr;
+    pendingRecords += frame(kRedoRecord, std::string());
+    return &versions[++currentIndex];
+}
+
+const VaultVersion *VersionHistory::undoTarget() const {
+    if (currentIndex == 0) return nullptr;
+    return &versions[currentIndex];
+}
+
+const VaultVersion *VersionHistory::redoTarget() const {
+    if (currentIndex + 1 >= versions.size()) return nullptr;
+    return &versions[currentIndex + 1];
+}
+
+bool VersionHistory::flush() {
+    if (pendingRecords.empty()) return true;
+    return append(std::string());
+}
+
+const VaultVersion &VersionHistory::current() const {
+    return versions[currentIndex];
+}
+
+const VaultVersion *VersionHistory::find(uint64_t number) const {
+    auto it = std::lower_bound(versions.begin(), versions.end(), number,
+                               [](const VaultVersion &v, uint64_t target) { return v.number < target; });
+    if (it == versions.end() || it->number != number) return nullptr;
+    return &*it;
+}
+
+const std::deque<VaultVersion> &VersionHistory::allVersions() const {
+    return versions;
+}
+
+uint64_t VersionHistory::newEntryId() {
+    return nextEntryId++;
+}
+
+size_t VersionHistory::pruneToCount(size_t count) {
+    if (versions.size() <= count) return 0;
+    return pruneFront(versions.size() - std::max<size_t>(count, 1));
+}
+
+size_t VersionHistory::pruneOlderThan(std::time_t cutoff) {
+    size_t count = 0;
+    while (count + 1 < versions.size() && versions[count].timestamp < cutoff) {
+        ++count;
+    }
+    return pruneFront(count);
+}
+
+void VersionHistory::applyCommit(VaultVersion version) {
+    versions.erase(versions.begin() + currentIndex + 1, versions.end());
+
+    PersistentEntryMap entries = versions.back().entries;
+    for (const auto &change : version.changes) {
+        entries = change.after ? entries.set(change.id, change.after) : entries.erase(change.id);
+        nextEntryId = std::max(nextEntryId, change.id + 1);
+    }
+    version.entries = entries;
+    versions.push_back(std::move(version));
+    currentIndex = versions.size() - 1;
+}
+
+size_t VersionHistory::pruneFront(size_t count) {
+    count = std::min(count, currentIndex);
+    if (count == 0) return 0;
+
+    versions.erase(versions.begin(), versions.begin() + count);
+    currentIndex -= count;
+    versions.front().changes.clear();
+    rewrite();
+    return count;
+}
+
+bool VersionHistory::append(const std::string &records) {
+    // A log that does not match the versions in memory yet is written out
+    // in full instead; the new records are part of it.
+    if (!logCurrent) {
+        return rewrite();
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::app);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file for writing: " << filename << "\n";
+        return false;
+    }
+    std::string content = pendingRecords + records;
+    file.write(content.data(), content.size());
+    file.close();
+    if (file.fail()) {
+        return false;
+    }
+    pendingRecords.clear();
+    return true;
+}
+
+bool VersionHistory::rewrite() {
+    std::string content(std::begin(kMagic), std::end(kMagic));
+    content += frame(kBaseRecord, encodeBase(versions.front(), nextEntryId));
+    for (size_t i = 1; i < versions.size(); ++i) {
+        content += frame(kCommitRecord, encodeCommit(versions[i]));
+    }
+    for (size_t i = currentIndex + 1; i < versions.size(); ++i) {
+        content += frame(kUndoRecord, std::string());
+    }
+
+    // A log that was never loaded belongs to another vault state; keep it
+    // aside instead of overwriting it.
+    if (replaceLog) {
+        const std::string backup = filename + ".bak";
+        std::remove(backup.c_str());
+        std::rename(filename.c_str(), backup.c_str());
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file for writing: " << filename << "\n";
+        return false;
+    }
+    file.write(content.data(), content.size());
+    file.close();
+    if (file.fail()) {
+        return false;
+    }
+    logCurrent = true;
+    replaceLog = false;
+    pendingRecords.clear();
+    return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "password.h"
+#include "persistent_map.h"
+
+struct EntryChange {
+    uint64_t id = 0;
+    std::shared_ptr<const Password> before;  // null when the entry was added
+    std::shared_ptr<const Password> after;   // null when the entry was removed
+};
+
+struct VaultVersion {
+    uint64_t number = 0;
+    std::time_t timestamp = 0;
+    std::string description;
+    std::vector<EntryChange> changes;  // relative to the previous version
+    PersistentEntryMap entries;        // vault contents as of this version
+};
+
+// Version history of the vault, persisted as an append-only log next to it.
+//
+// Every version keeps a structurally shared snapshot of the vault, so viewing
+// an old version is free and a commit costs O(log n) memory per changed
+// entry. Undo and redo move a cursor over the versions; committing after an
+// undo discards the undone versions. Pruning drops the oldest versions and
+// rewrites the log starting from a snapshot of the new oldest version.
+class VersionHistory {
+public:
+    explicit VersionHistory(const std::string &filename);
+
+    // Replays the log. Returns false if it is missing or unreadable. Neither
+    // load() nor reset() writes the log: it is created, replaced or cleaned
+    // of a torn tail when the next record is written.
+    bool load();
+    // Starts a new history whose only version holds the given passwords;
+    // ids receives the entry id assigned to each of them. The log it
+    // replaces is kept as <file>.bak once the new one is written.
+    void reset(const std::vector<Password> &passwords, std::vector<uint64_t> &ids);
+
+    bool commit(const std::string &description, std::vector<EntryChange> changes);
+    // Return the version whose changes must be reverted (undo) or
+    // reapplied (redo), or nullptr when there is nothing to do. The cursor
+    // move is only logged by the next flush() or commit(), which callers
+    // issue once the vault itself has been saved.
+    const VaultVersion *undo();
+    const VaultVersion *redo();
+    // The versions undo() and redo() would return, without moving the cursor.
+    const VaultVersion *undoTarget() const;
+    const VaultVersion *redoTarget() const;
+    bool flush();
+
+    const VaultVersion &current() const;
+    const VaultVersion *find(uint64_t number) const;
+    const std::deque<VaultVersion> &allVersions() const;
+    uint64_t newEntryId();
+
+    // Both keep the current version and everything after it.
+    size_t pruneToCount(size_t count);
+    size_t pruneOlderThan(std::time_t cutoff);
+
+private:
+    std::string filename;
+    std::deque<VaultVersion> versions;
+    size_t currentIndex = 0;
+    uint64_t nextEntryId = 1;
+    bool logCurrent = false;  // the log on disk holds exactly these versions
+    bool replaceLog = true;   // a log on disk is not ours and is kept aside
+    std::string pendingRecords;  // cursor moves not yet written
+
+    void applyCommit(VaultVersion version);
+    size_t pruneFront(size_t count);
+    bool append(const std::string &records);
+    bool rewrite();
+};
@@ -0,0 +1,334 @@
+#include "gtest/gtest.h"
+#include "file_handler.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+class FileHandlerTest : public ::testing::Test
+{
+protected:
+    FileHandlerTest() : handler(kFile)
+    {
+        std::remove(kFile);
+    }
+    ~FileHandlerTest() override
+    {
+        std::remove(kFile);
+    }
+
+    static Password makePassword(int i)
+    {
+        std::string n = std::to_string(i);
+        return Password{"entry" + n, "secret" + n, "Work", "site" + n + ".com", "user" + n};
+    }
+
+    static constexpr const char *kFile = "test_vault.dat";
+    FileHandler handler;
+};
+
+TEST_F(FileHandlerTest, InsertAndReload)
+{
+    std::vector<RecordId> ids(300);
+    for (int i = 0; i < 300; ++i)
+    {
+        ASSERT_TRUE(handler.insertRecord(makePassword(i), ids[i]));
+    }
+    ASSERT_TRUE(handler.flush());
+    EXPECT_GT(handler.pageCount(), 2u);
+
+    FileHandler reader(kFile);
+    std::vector<Password> loaded;
+    std::vector<RecordId> loadedIds;
+    ASSERT_TRUE(reader.loadPasswords(loaded, loadedIds));
+    ASSERT_EQ(loaded.size(), 300u);
+    EXPECT_EQ(loaded[0].name, "entry0");
+    EXPECT_EQ(loaded[299].login, "user299");
+}
+
+TEST_F(FileHandlerTest, EditRewritesOnlyTouchedPage)
+{
+    std::vector<RecordId> ids(300);
+    for (int i = 0; i < 300; ++i)
+    {
+        handler.insertRecord(makePassword(i), ids[i]);
+    }
+    handler.flush();
+
+    Password edited = makePassword(150);
+    edited.password = "changed";
+    ASSERT_TRUE(handler.updateRecord(ids[150], edited));
+    ASSERT_TRUE(handler.flush());
+    EXPECT_EQ(handler.lastFlushPageWrites(), 1u);
+
+    ASSERT_TRUE(handler.removeRecord(ids[10]));
+    ASSERT_TRUE(handler.flush());
+    EXPECT_EQ(handler.lastFlushPageWrites(), 1u);
+
+    std::vector<std::string> problems;
+    EXPECT_TRUE(handler.checkConsistency(problems));
+    EXPECT_TRUE(problems.empty());
+}
+
+TEST_F(FileHandlerTest, GrowingRecordMovesWhenPageIsFull)
+{
+    std::vector<RecordId> ids(300);
+    for (int i = 0; i < 300; ++i)
+    {
+        handler.insertRecord(makePassword(i), ids[i]);
+    }
+    RecordId id = ids[0];
+    Password big = makePassword(0);
+    big.website = std::string(2000, 'w');
+    ASSERT_TRUE(handler.updateRecord(id, big));
+    EXPECT_NE(id.page, ids[0].page);
+    handler.flush();
+
+    FileHandler reader(kFile);
+    std::vector<Password> loaded;
+    std::vector<RecordId> loadedIds;
+    ASSERT_TRUE(reader.loadPasswords(loaded, loadedIds));
+    EXPECT_EQ(loaded.size(), 300u);
+}
+
+TEST_F(FileHandlerTest, VacuumReclaimsSpace)
+{
+    std::vector<Password> passwords;
+    std::vector<RecordId> ids(1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        handler.insertRecord(makePassword(i), ids[i]);
+    }
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i % 10 == 0)
+            passwords.push_back(makePassword(i));
+        else
+            handler.removeRecord(ids[i]);
+    }
+    handler.flush();
+    size_t pagesBefore = handler.pageCount();
+
+    ASSERT_TRUE(handler.savePasswords(passwords, ids));
+    EXPECT_LT(handler.pageCount(), pagesBefore);
+    ASSERT_EQ(ids.size(), passwords.size());
+
+    std::vector<std::string> problems;
+    EXPECT_TRUE(handler.checkConsistency(problems));
+}
+
+TEST_F(FileHandlerTest, ConsistencyCheckDetectsCorruption)
+{
+    RecordId id;
+    handler.insertRecord(makePassword(1), id);
+    handler.flush();
+
+    {
+        std::fstream file(kFile, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(FileHandler::kPageSize + 4);
+        const char bad[2] = {0x01, 0x00};  // free space end inside the slot directory
+        file.write(bad, 2);
+    }
+
+    std::vector<std::string> problems;
+    EXPECT_FALSE(handler.checkConsistency(problems));
+    EXPECT_FALSE(problems.empty());
+}
+
+TEST_F(FileHandlerTest, DamagedPageIsNotRewrittenOnLoad)
+{
+    RecordId id;
+    handler.insertRecord(makePassword(1), id);
+    handler.flush();
+
+    std::string damagedPage;
+    {
+        std::fstream file(kFile, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(FileHandler::kPageSize);
+        const char bad[2] = {'\xff', '\xff'};  // slot count far beyond the page
+        file.write(bad, 2);
+        file.seekg(FileHandler::kPageSize);
+        damagedPage.resize(FileHandler::kPageSize);
+        file.read(&damagedPage[0], FileHandler::kPageSize);
+    }
+
+    FileHandler reopened(kFile);
+    std::vector<Password> passwords;
+    std::vector<RecordId> ids;
+    ASSERT_TRUE(reopened.loadPasswords(passwords, ids));
+    EXPECT_TRUE(passwords.empty());
+    ASSERT_TRUE(reopened.insertRecord(makePassword(2), id));
+    EXPECT_NE(id.page, 1u);
+    ASSERT_TRUE(reopened.flush());
+
+    std::ifstream file(kFile, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content.substr(FileHandler::kPageSize, FileHandler::kPageSize), damagedPage);
+    std::vector<std::string> problems;
+    EXPECT_FALSE(reopened.checkConsistency(problems));
+
+    ASSERT_TRUE(reopened.loadPasswords(passwords, ids));
+    ASSERT_TRUE(reopened.savePasswords(passwords, ids));
+    problems.clear();
+    EXPECT_TRUE(reopened.checkConsistency(problems));
+}
+
+TEST_F(FileHandlerTest, LoadsVaultWithStalePageCount)
+{
+    std::vector<RecordId> ids(200);
+    for (int i = 0; i < 200; ++i)
+    {
+        handler.insertRecord(makePassword(i), ids[i]);
+    }
+    ASSERT_TRUE(handler.flush());
+    size_t pages = handler.pageCount();
+
+    std::string content;
+    {
+        std::ifstream file(kFile, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    content.resize((pages - 1) * FileHandler::kPageSize);  // lose the last page, keep the header
+    std::ofstream(kFile, std::ios::binary | std::ios::trunc).write(content.data(), content.size());
+
+    FileHandler reopened(kFile);
+    std::vector<std::string> problems;
+    EXPECT_FALSE(reopened.checkConsistency(problems));
+    std::vector<Password> loaded;
+    std::vector<RecordId> loadedIds;
+    ASSERT_TRUE(reopened.loadPasswords(loaded, loadedIds));
+    size_t survivors = loaded.size();
+    EXPECT_GT(survivors, 100u);
+
+    RecordId id;
+    ASSERT_TRUE(reopened.insertRecord(makePassword(500), id));
+    ASSERT_TRUE(reopened.flush());
+    ASSERT_TRUE(reopened.loadPasswords(loaded, loadedIds));
+    EXPECT_EQ(loaded.size(), survivors + 1);
+    problems.clear();
+    EXPECT_TRUE(reopened.checkConsistency(problems));
+}
+
+TEST_F(FileHandlerTest, UnreadableFileIsMovedAsideBeforeWriting)
+{
+    const std::string backup = std::string(kFile) + ".bak";
+    std::ofstream(kFile, std::ios::binary) << "not a vault";
+
+    std::vector<Password> loaded;
+    std::vector<RecordId> ids;
+    EXPECT_FALSE(handler.loadPasswords(loaded, ids));
+    RecordId id;
+    ASSERT_TRUE(handler.insertRecord(makePassword(1), id));
+    ASSERT_TRUE(handler.flush());
+
+    std::ifstream kept(backup, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(kept)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content, "not a vault");
+    ASSERT_TRUE(handler.loadPasswords(loaded, ids));
+    EXPECT_EQ(loaded.size(), 1u);
+    std::remove(backup.c_str());
+}
+
+TEST_F(FileHandlerTest, RejectsOversizedRecord)
+{
+    RecordId id;
+    Password huge = makePassword(1);
+    huge.password = std::string(FileHandler::kPageSize, 'x');
+    EXPECT_FALSE(handler.insertRecord(huge, id));
+}
+
+TEST_F(FileHandlerTest, RepackFailsWhenRecordDoesNotFitTargetMode)
+{
+    Password large = makePassword(1);
+    large.password = std::string(4040, 'x');  // fits plain pages only
+    std::vector<RecordId> ids;
+    ASSERT_TRUE(handler.savePasswords({large, makePassword(2)}, ids));
+
+    handler.setCompressed(true);
+    EXPECT_FALSE(handler.savePasswords({large, makePassword(2)}, ids));
+    EXPECT_TRUE(handler.saveImage({large}, ids).empty());
+
+    FileHandler reader(kFile);
+    std::vector<Password> loaded;
+    ASSERT_TRUE(reader.loadPasswords(loaded, ids));
+    EXPECT_EQ(loaded.size(), 2u);
+    EXPECT_FALSE(reader.isCompressed());
+}
+
+TEST_F(FileHandlerTest, CompressedRoundTripIsSmaller)
+{
+    std::vector<Password> passwords;
+    for (int i = 0; i < 500; ++i)
+    {
+        std::string n = std::to_string(i);
+        passwords.push_back(Password{"entry" + n, "secret" + n, "Work",
+                                     "accounts.example-corp.com", "firstname.lastname@example-corp.com"});
+    }
+    std::vector<RecordId> ids;
+    ASSERT_TRUE(handler.savePasswords(passwords, ids));
+    size_t plainPages = handler.pageCount();
+
+    handler.setCompressed(true);
+    ASSERT_TRUE(handler.savePasswords(passwords, ids));
+    EXPECT_TRUE(handler.isCompressed());
+    EXPECT_LT(handler.pageCount(), plainPages);
+
+    FileHandler reader(kFile);
+    std::vector<Password> loaded;
+    ASSERT_TRUE(reader.loadPasswords(loaded, ids));
+    EXPECT_TRUE(reader.isCompressed());
+    ASSERT_EQ(loaded.size(), passwords.size());
+    EXPECT_EQ(loaded[42].website, "accounts.example-corp.com");
+    EXPECT_EQ(loaded[42].login, "firstname.lastname@example-corp.com");
+
+    std::vector<std::string> problems;
+    EXPECT_TRUE(reader.checkConsistency(problems));
+}
+
+TEST_F(FileHandlerTest, ImageRoundTripDoesNotTouchFile)
+{
+    std::vector<Password> passwords{makePassword(1), makePassword(2)};
+    std::vector<RecordId> ids;
+    handler.setCompressed(true);
+    std::string image = handler.saveImage(passwords, ids);
+    EXPECT_EQ(image.size(), handler.pageCount() * FileHandler::kPageSize);
+    EXPECT_FALSE(std::ifstream(kFile).is_open());
+
+    FileHandler reader(kFile);
+    std::vector<Password> loaded;
+    ASSERT_TRUE(reader.loadImage(image, loaded, ids));
+    EXPECT_TRUE(reader.isCompressed());
+    ASSERT_EQ(loaded.size(), 2u);
+    EXPECT_EQ(loaded[1].login, "user2");
+}
+
+TEST_F(FileHandlerTest, CompressedIncrementalUpdates)
+{
+    handler.setCompressed(true);
+    std::vector<RecordId> ids;
+    ASSERT_TRUE(handler.savePasswords({makePassword(1), makePassword(2)}, ids));
+
+    RecordId added;
+    ASSERT_TRUE(handler.insertRecord(makePassword(3), added));
+    Password edited = makePassword(1);
+    edited.website = "new.example.com";
+    ASSERT_TRUE(handler.updateRecord(ids[0], edited));
+    ASSERT_TRUE(handler.removeRecord(ids[1]));
+    ASSERT_TRUE(handler.flush());
+
+    FileHandler reader(kFile);
+    std::vector<Password> loaded;
+    ASSERT_TRUE(reader.loadPasswords(loaded, ids));
+    ASSERT_EQ(loaded.size(), 2u);
+    bool foundEdited = false, foundAdded = false;
+    for (const auto &p : loaded)
+    {
+        foundEdited |= p.name == "entry1" && p.website == "new.example.com";
+        foundAdded |= p.name == "entry3" && p.login == "user3";
+    }
+    EXPECT_TRUE(foundEdited);
+    EXPECT_TRUE(foundAdded);
+
+    std::vector<std::string> problems;
+    EXPECT_TRUE(reader.checkConsistency(problems));
+}
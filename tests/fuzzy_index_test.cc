@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+#include "fuzzy_index.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace
+{
+
+// Reference optimal string alignment distance, used to check the index.
+int osaDistance(const std::string &a, const std::string &b)
+{
+    std::vector<std::vector<int>> d(a.size() + 1, std::vector<int>(b.size() + 1));
+    for (size_t i = 0; i <= a.size(); ++i)
+        d[i][0] = static_cast<int>(i);
+    for (size_t j = 0; j <= b.size(); ++j)
+        d[0][j] = static_cast<int>(j);
+    for (size_t i = 1; i <= a.size(); ++i)
+    {
+        for (size_t j = 1; j <= b.size(); ++j)
+        {
+            int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            d[i][j] = std::min({d[i - 1][j] + 1, d[i][j - 1] + 1, d[i - 1][j - 1] + cost});
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+                d[i][j] = std::min(d[i][j], d[i - 2][j - 2] + 1);
+        }
+    }
+    return d[a.size()][b.size()];
+}
+
+std::string randomWord(std::mt19937 &rng, size_t maxLength)
+{
+    std::uniform_int_distribution<size_t> length(1, maxLength);
+    std::uniform_int_distribution<int> letter('a', 'd');
+    std::string word(length(rng), 'a');
+    for (auto &c : word)
+        c = static_cast<char>(letter(rng));
+    return word;
+}
+
+}  // namespace
+
+TEST(FuzzyIndexTest, FindsTyposRankedByDistance)
+{
+    FuzzyIndex index;
+    index.add("github", "GitHub");
+    index.add("gitlab", "GitLab");
+    index.add("Bank", "Bank");
+
+    auto matches = index.search("gtihub", 5);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0].name, "GitHub");
+    EXPECT_EQ(matches[0].distance, 1);
+
+    matches = index.search("gituab", 5);
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matches[0].name, "GitLab");
+    EXPECT_EQ(matches[1].distance, 2);
+    EXPECT_GT(matches[0].score, matches[1].score);
+
+    EXPECT_TRUE(index.search("completely-different", 5).empty());
+}
+
+TEST(FuzzyIndexTest, AllowedEditsGrowWithQueryLength)
+{
+    FuzzyIndex index;
+    index.add("go", "Go");
+    index.add("bank", "Bank");
+    index.add("netflix", "Netflix");
+
+    EXPECT_TRUE(index.search("ga", 5).empty());
+    EXPECT_EQ(index.search("go", 5).size(), 1u);
+    EXPECT_EQ(index.search("bnak", 5).size(), 1u);
+    EXPECT_TRUE(index.search("bxnx", 5).empty());
+    EXPECT_TRUE(index.search("ntflx", 5).empty());
+    EXPECT_EQ(index.search("netflx", 5).size(), 1u);
+    EXPECT_EQ(index.search("nteflx", 5).size(), 1u);
+    EXPECT_TRUE(index.search("betflx", 5).empty());
+    EXPECT_EQ(index.search("betflix", 5).size(), 1u);
+}
+
+TEST(FuzzyIndexTest, MatchesReferenceDistance)
+{
+    std::mt19937 rng(7);
+    std::vector<std::string> words;
+    FuzzyIndex index;
+    for (int i = 0; i < 400; ++i)
+    {
+        words.push_back(randomWord(rng, 12));
+        index.add(words.back(), words.back());
+    }
+
+    for (int q = 0; q < 100; ++q)
+    {
+        std::string query = randomWord(rng, 13);
+        int allowed = query.size() <= 2 ? 0 : query.size() <= 5 ? 1 : 2;
+        std::map<std::string, int> expected;
+        for (const auto &word : words)
+        {
+            int distance = osaDistance(query, word);
+            if (distance <= allowed && (distance <= 1 || word[0] == query[0]))
+                expected[word] = distance;
+        }
+
+        std::map<std::string, int> found;
+        for (const auto &match : index.search(query, words.size()))
+            found[match.name] = match.distance;
+        EXPECT_EQ(found, expected) << "query " << query;
+    }
+}
+
+TEST(FuzzyIndexTest, AssignMatchesIncrementalAdds)
+{
+    std::vector<std::pair<std::string, std::string>> entries{
+        {"Netflix", "tv"}, {"github", "code"}, {"github", "work"}, {"gitlab", "ops"}, {"bank", "money"}};
+
+    FuzzyIndex bulk;
+    bulk.assign(entries);
+    FuzzyIndex incremental;
+    for (const auto &entry : entries)
+        incremental.add(entry.first, entry.second);
+
+    for (const char *query : {"netflx", "githbu", "gitlub", "bnak", "github"})
+    {
+        auto expected = incremental.search(query, 10);
+        auto actual = bulk.search(query, 10);
+        ASSERT_EQ(actual.size(), expected.size()) << query;
+        for (size_t i = 0; i < actual.size(); ++i)
+        {
+            EXPECT_EQ(actual[i].name, expected[i].name);
+            EXPECT_EQ(actual[i].term, expected[i].term);
+            EXPECT_EQ(actual[i].distance, expected[i].distance);
+        }
+    }
+    EXPECT_EQ(bulk.search("githbu", 5).size(), 2u);
+}
+
+TEST(FuzzyIndexTest, RespectsLimitAndRemoval)
+{
+    FuzzyIndex index;
+    for (int i = 0; i < 20; ++i)
+    {
+        index.add("example.com", "entry" + std::to_string(i));
+    }
+    EXPECT_EQ(index.search("exmaple.com", 5).size(), 5u);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        index.remove("example.com", "entry" + std::to_string(i));
+    }
+    EXPECT_TRUE(index.search("example.com", 5).empty());
+}
@@ -1,6 +1,9 @@
 #include "gtest/gtest.h"
 #include "password_manager.h"
 
+#include <cstdio>
+#include <fstream>
+
 class PasswordManagerTest : public ::testing::Test
 {
 protected:
@@ -41,6 +44,25 @@ TEST_F(PasswordManagerTest, RemovePassword)
     EXPECT_FALSE(manager.removePassword("RemoveMe")); // Already removed
 }
 
+TEST_F(PasswordManagerTest, AddRejectsOversizedEntry)
+{
+    Password pwd{"Huge", std::string(5000, 'x'), "TestCat", "example.com", "admin"};
+    EXPECT_FALSE(manager.addPassword(pwd));
+    EXPECT_TRUE(manager.getPasswords().empty());
+}
+
+TEST_F(PasswordManagerTest, StorageSwitchRefusesEntriesThatNoLongerFit)
+{
+    ASSERT_TRUE(manager.addPassword(Password{"Large", std::string(4060, 'x'), "TestCat", "", ""}));
+    ASSERT_TRUE(manager.addPassword(Password{"Small", "pw", "TestCat", "", ""}));
+
+    EXPECT_FALSE(manager.setCompressedStorage(true));
+    EXPECT_FALSE(manager.isCompressedStorage());
+
+    PasswordManager reopened("test_passwords.dat");
+    EXPECT_EQ(reopened.getPasswords().size(), 2u);
+}
+
 TEST_F(PasswordManagerTest, EditPassword)
 {
     Password pwd{"EditMe", "pass", "TestCat", "example.com", "admin"};
@@ -106,6 +128,194 @@ TEST_F(PasswordManagerTest, SearchPasswords)
     EXPECT_NE(output.find("No matching passwords found"), std::string::npos);
 }
 
+TEST_F(PasswordManagerTest, FuzzySearchToleratesTypos)
+{
+    manager.addPassword(Password{"GitHub", "pw1", "Work", "https://www.github.com/login", "dev"});
+    manager.addPassword(Password{"Mail", "pw2", "Personal", "mail.example.com", "me"});
+
+    auto matches = manager.fuzzySearch("gtihub", 5);
+    ASSERT_FALSE(matches.empty());
+    EXPECT_EQ(matches[0].name, "GitHub");
+
+    matches = manager.fuzzySearch("exmaple", 5);
+    ASSERT_FALSE(matches.empty());
+    EXPECT_EQ(matches[0].name, "Mail");
+
+    Password renamed{"Mailbox", "pw2", "Personal", "mail.example.com", "me"};
+    ASSERT_TRUE(manager.editPassword("Mail", renamed));
+    matches = manager.fuzzySearch("mailbx", 5);
+    ASSERT_FALSE(matches.empty());
+    EXPECT_EQ(matches[0].name, "Mailbox");
+
+    manager.removePassword("GitHub");
+    EXPECT_TRUE(manager.fuzzySearch("github", 5).empty());
+}
+
+TEST_F(PasswordManagerTest, CompletesNamesCategoriesAndWebsites)
+{
+    manager.addPassword(Password{"GitHub", "pw1", "Work", "github.com", "dev"});
+    manager.addPassword(Password{"Gitlab", "pw2", "Work", "gitlab.com", "dev"});
+    manager.addPassword(Password{"Bank", "pw3", "Personal", "bank.example", "me"});
+
+    auto names = manager.complete(CompletionField::Name, "git", 10);
+    ASSERT_EQ(names.size(), 2u);
+    EXPECT_EQ(names[0], "GitHub");
+
+    auto categories = manager.complete(CompletionField::Category, "p", 10);
+    ASSERT_EQ(categories.size(), 1u);
+    EXPECT_EQ(categories[0], "Personal");
+
+    manager.editPassword("Gitlab", Password{"Codeberg", "pw2", "Work", "codeberg.org", "dev"});
+    EXPECT_EQ(manager.complete(CompletionField::Name, "git", 10).size(), 1u);
+    EXPECT_EQ(manager.complete(CompletionField::Website, "code", 10).size(), 1u);
+
+    manager.removeCategory("Personal");
+    EXPECT_TRUE(manager.complete(CompletionField::Category, "p", 10).empty());
+    EXPECT_TRUE(manager.complete(CompletionField::Name, "bank", 10).empty());
+}
+
+TEST_F(PasswordManagerTest, CompletesFromFileWithoutLoading)
+{
+    manager.addPassword(Password{"GitHub", "pw1", "Work", "github.com", "dev"});
+    manager.addPassword(Password{"gitea", "pw2", "Work", "gitea.io", "dev"});
+    manager.addPassword(Password{"Bank", "pw3", "Personal", "bank.example", "me"});
+
+    for (bool compressed : {false, true})
+    {
+        ASSERT_TRUE(manager.setCompressedStorage(compressed));
+        for (auto field : {CompletionField::Name, CompletionField::Category, CompletionField::Website})
+        {
+            for (const char *prefix : {"", "GIT", "w", "bank.", "x"})
+            {
+                EXPECT_EQ(PasswordManager::completeFromFile("test_passwords.dat", field, prefix, 2),
+                          manager.complete(field, prefix, 2));
+            }
+        }
+    }
+    ASSERT_TRUE(manager.setCompressedStorage(false));
+    EXPECT_TRUE(PasswordManager::completeFromFile("missing_vault.dat", CompletionField::Name, "", 10).empty());
+}
+
+TEST_F(PasswordManagerTest, UndoRedoRestoresEntries)
+{
+    manager.addPassword(Password{"UndoMe", "old", "Work", "", ""});
+    manager.addPassword(Password{"Other", "pw", "Work", "", ""});
+
+    Password edited{"UndoMe", "new", "Work", "", ""};
+    ASSERT_TRUE(manager.editPassword("UndoMe", edited));
+    manager.removeCategory("Work");
+    EXPECT_TRUE(manager.getPasswords().empty());
+
+    ASSERT_TRUE(manager.undo());
+    ASSERT_EQ(manager.getPasswords().size(), 2u);
+    ASSERT_TRUE(manager.undo());
+    for (const auto &p : manager.getPasswords())
+    {
+        if (p.name == "UndoMe")
+        {
+            EXPECT_EQ(p.password, "old");
+        }
+    }
+
+    ASSERT_TRUE(manager.redo());
+    {
+        // History and vault survive reopening; the undone category removal can still be redone
+        PasswordManager reopened("test_passwords.dat");
+        EXPECT_EQ(reopened.getPasswords().size(), 2u);
+
+        testing::internal::CaptureStdout();
+        reopened.printHistory();
+        std::string output = testing::internal::GetCapturedStdout();
+        EXPECT_NE(output.find("Remove category Work"), std::string::npos);
+    }
+    ASSERT_TRUE(manager.redo());
+    EXPECT_TRUE(manager.getPasswords().empty());
+    EXPECT_FALSE(manager.redo());
+}
+
+TEST_F(PasswordManagerTest, UndoRestoresLargeBatchWithIndexes)
+{
+    for (int i = 0; i < 40; ++i)
+    {
+        std::string id = std::to_string(i);
+        manager.addPassword(Password{"Batch" + id, "pw" + id, "Work", "site" + id + ".com", ""});
+    }
+    manager.addPassword(Password{"Kept", "pw", "Personal", "", ""});
+    manager.removeCategory("Work");
+    ASSERT_EQ(manager.getPasswords().size(), 1u);
+
+    ASSERT_TRUE(manager.undo());
+    EXPECT_EQ(manager.getPasswords().size(), 41u);
+    EXPECT_EQ(manager.complete(CompletionField::Name, "batch3", 50).size(), 11u);
+    auto matches = manager.fuzzySearch("site17", 5);
+    ASSERT_FALSE(matches.empty());
+    EXPECT_EQ(matches.front().name, "Batch17");
+
+    ASSERT_TRUE(manager.redo());
+    EXPECT_EQ(manager.getPasswords().size(), 1u);
+    EXPECT_TRUE(manager.complete(CompletionField::Name, "batch", 50).empty());
+    PasswordManager reopened("test_passwords.dat");
+    EXPECT_EQ(reopened.getPasswords().size(), 1u);
+}
+
+TEST_F(PasswordManagerTest, UndoFailsWhenEntryNoLongerFits)
+{
+    // Fits plain pages only
+    ASSERT_TRUE(manager.addPassword(Password{"Large", std::string(4040, 'x'), "TestCat", "", ""}));
+    ASSERT_TRUE(manager.removePassword("Large"));
+    ASSERT_TRUE(manager.setCompressedStorage(true));
+
+    EXPECT_FALSE(manager.undo());
+    EXPECT_TRUE(manager.getPasswords().empty());
+    EXPECT_FALSE(manager.redo());
+
+    // The failed undo left the history where it was
+    ASSERT_TRUE(manager.setCompressedStorage(false));
+    ASSERT_TRUE(manager.undo());
+    ASSERT_EQ(manager.getPasswords().size(), 1u);
+    EXPECT_EQ(manager.getPasswords()[0].name, "Large");
+}
+
+TEST(PasswordManagerOpenTest, OpeningWritesNoHistory)
+{
+    const char *vault = "test_open_vault.dat";
+    const std::string log = std::string(vault) + ".history";
+    std::remove(log.c_str());
+    {
+        PasswordManager manager(vault);
+        EXPECT_FALSE(std::ifstream(log).is_open());
+        EXPECT_TRUE(manager.addPassword(Password{"First", "pw", "Work", "", ""}));
+    }
+    EXPECT_TRUE(std::ifstream(log).is_open());
+    std::remove(vault);
+    std::remove(log.c_str());
+}
+
+TEST_F(PasswordManagerTest, ViewsAndEntryHistory)
+{
+    manager.addPassword(Password{"Viewed", "v1", "Work", "", ""});
+    PersistentEntryMap before;
+    testing::internal::CaptureStdout();
+    manager.printHistory();
+    std::string output = testing::internal::GetCapturedStdout();
+    size_t marker = output.find("* ");
+    ASSERT_NE(marker, std::string::npos);
+    uint64_t version = std::stoull(output.substr(marker + 2));
+    ASSERT_TRUE(manager.viewAt(version, before));
+
+    manager.editPassword("Viewed", Password{"Viewed", "v2", "Work", "", ""});
+    bool sawOld = false;
+    before.forEach([&sawOld](uint64_t, const Password &p)
+                   { sawOld |= p.name == "Viewed" && p.password == "v1"; });
+    EXPECT_TRUE(sawOld);
+
+    testing::internal::CaptureStdout();
+    manager.printEntryHistory("Viewed");
+    output = testing::internal::GetCapturedStdout();
+    EXPECT_NE(output.find("Password: v1"), std::string::npos);
+    EXPECT_NE(output.find("Password: v2"), std::string::npos);
+}
+
 TEST_F(PasswordManagerTest, CategoryManagement)
 {
     std::string category = "TestCategory";
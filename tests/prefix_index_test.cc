@@ -0,0 +1,35 @@
+#include "gtest/gtest.h"
+#include "prefix_index.h"
+
+TEST(PrefixIndexTest, CompletesCaseInsensitivelyInOrder)
+{
+    PrefixIndex index;
+    index.add("GitHub");
+    index.add("gitlab");
+    index.add("Gmail");
+    index.add("Bank");
+
+    auto matches = index.complete("GI", 10);
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matches[0], "GitHub");
+    EXPECT_EQ(matches[1], "gitlab");
+
+    EXPECT_EQ(index.complete("g", 2).size(), 2u);
+    EXPECT_EQ(index.complete("", 10).size(), 4u);
+    EXPECT_TRUE(index.complete("x", 10).empty());
+}
+
+TEST(PrefixIndexTest, CountsDuplicatesUntilLastRemoval)
+{
+    PrefixIndex index;
+    index.assign({"example.com", "example.com", "", "other.com"});
+    EXPECT_EQ(index.size(), 2u);
+
+    index.remove("example.com");
+    EXPECT_EQ(index.complete("ex", 10).size(), 1u);
+    index.remove("example.com");
+    EXPECT_TRUE(index.complete("ex", 10).empty());
+
+    index.remove("missing.com");
+    EXPECT_EQ(index.size(), 1u);
+}
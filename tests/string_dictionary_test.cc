@@ -0,0 +1,58 @@
+#include "gtest/gtest.h"
+#include "string_dictionary.h"
+
+TEST(StringDictionaryTest, InternReturnsStableIds)
+{
+    StringDictionary dictionary;
+    EXPECT_EQ(dictionary.intern(""), 0u);
+
+    uint32_t github = dictionary.intern("github.com");
+    uint32_t gitlab = dictionary.intern("gitlab.com");
+    EXPECT_NE(github, gitlab);
+    EXPECT_EQ(dictionary.intern("github.com"), github);
+    EXPECT_EQ(dictionary.size(), 2u);
+    ASSERT_NE(dictionary.find(gitlab), nullptr);
+    EXPECT_EQ(*dictionary.find(gitlab), "gitlab.com");
+    EXPECT_EQ(dictionary.find(42), nullptr);
+}
+
+TEST(StringDictionaryTest, FrontCodedBlocksRoundTrip)
+{
+    StringDictionary dictionary;
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < 200; ++i)
+    {
+        ids.push_back(dictionary.intern("mail.example" + std::to_string(i) + ".com"));
+    }
+
+    auto blocks = dictionary.encodeBlocks(ids, 512);
+    ASSERT_GT(blocks.size(), 1u);
+
+    StringDictionary restored;
+    size_t total = 0;
+    for (const auto &block : blocks)
+    {
+        EXPECT_LE(block.size(), 512u);
+        std::vector<std::pair<uint32_t, std::string>> entries;
+        ASSERT_TRUE(StringDictionary::decodeBlock(block.data(), block.size(), entries));
+        for (const auto &entry : entries)
+        {
+            EXPECT_TRUE(restored.add(entry.first, entry.second));
+        }
+        total += entries.size();
+    }
+    EXPECT_EQ(total, ids.size());
+    for (uint32_t id : ids)
+    {
+        ASSERT_NE(restored.find(id), nullptr);
+        EXPECT_EQ(*restored.find(id), *dictionary.find(id));
+    }
+}
+
+TEST(StringDictionaryTest, RejectsConflictingIds)
+{
+    StringDictionary dictionary;
+    EXPECT_TRUE(dictionary.add(3, "example.com"));
+    EXPECT_FALSE(dictionary.add(3, "other.com"));
+    EXPECT_FALSE(dictionary.add(4, "example.com"));
+}
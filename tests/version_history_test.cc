@@ -0,0 +1,184 @@
+#include "gtest/gtest.h"
+#include "version_history.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+
+std::shared_ptr<const Password> entry(const std::string &name, const std::string &password)
+{
+    return std::make_shared<const Password>(Password{name, password, "Work", "", ""});
+}
+
+} // namespace
+
+TEST(PersistentEntryMapTest, OldVersionsAreUnchanged)
+{
+    PersistentEntryMap empty;
+    PersistentEntryMap v1 = empty.set(1, entry("a", "1")).set(2, entry("b", "2"));
+    PersistentEntryMap v2 = v1.set(2, entry("b", "changed")).erase(1);
+
+    EXPECT_EQ(empty.size(), 0u);
+    EXPECT_EQ(v1.size(), 2u);
+    EXPECT_EQ(v1.find(2)->password, "2");
+    EXPECT_EQ(v2.size(), 1u);
+    EXPECT_EQ(v2.find(1), nullptr);
+    EXPECT_EQ(v2.find(2)->password, "changed");
+}
+
+TEST(PersistentEntryMapTest, SharesUnchangedEntries)
+{
+    PersistentEntryMap map;
+    for (uint64_t id = 1; id <= 1000; ++id)
+    {
+        map = map.set(id, entry("e" + std::to_string(id), "p"));
+    }
+    PersistentEntryMap edited = map.set(500, entry("e500", "new"));
+
+    EXPECT_EQ(edited.find(1), map.find(1)); // same shared value
+    EXPECT_NE(edited.find(500), map.find(500));
+
+    std::vector<uint64_t> ids;
+    edited.forEach([&ids](uint64_t id, const Password &) { ids.push_back(id); });
+    ASSERT_EQ(ids.size(), 1000u);
+    EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+}
+
+class VersionHistoryTest : public ::testing::Test
+{
+protected:
+    VersionHistoryTest()
+    {
+        std::remove(kFile);
+    }
+    ~VersionHistoryTest() override
+    {
+        std::remove(kFile);
+    }
+
+    static constexpr const char *kFile = "test_history.dat";
+};
+
+TEST_F(VersionHistoryTest, UndoRedoAndReload)
+{
+    VersionHistory history(kFile);
+    std::vector<uint64_t> ids;
+    history.reset({Password{"a", "1", "", "", ""}}, ids);
+    ASSERT_EQ(ids.size(), 1u);
+
+    uint64_t added = history.newEntryId();
+    history.commit("Add b", {EntryChange{added, nullptr, entry("b", "2")}});
+    history.commit("Edit a", {EntryChange{ids[0], entry("a", "1"), entry("a", "3")}});
+    EXPECT_EQ(history.current().entries.size(), 2u);
+
+    const VaultVersion *undone = history.undo();
+    ASSERT_NE(undone, nullptr);
+    EXPECT_EQ(undone->description, "Edit a");
+    EXPECT_EQ(history.current().entries.find(ids[0])->password, "1");
+    ASSERT_TRUE(history.flush());
+
+    VersionHistory reloaded(kFile);
+    ASSERT_TRUE(reloaded.load());
+    EXPECT_EQ(reloaded.allVersions().size(), 3u);
+    EXPECT_EQ(reloaded.current().description, "Add b");
+    ASSERT_NE(reloaded.redo(), nullptr);
+    EXPECT_EQ(reloaded.current().entries.find(ids[0])->password, "3");
+    EXPECT_EQ(reloaded.redo(), nullptr);
+    EXPECT_GT(reloaded.newEntryId(), added);
+}
+
+TEST_F(VersionHistoryTest, CommitAfterUndoDropsRedo)
+{
+    VersionHistory history(kFile);
+    std::vector<uint64_t> ids;
+    history.reset({}, ids);
+    history.commit("Add a", {EntryChange{history.newEntryId(), nullptr, entry("a", "1")}});
+    history.undo();
+    history.commit("Add b", {EntryChange{history.newEntryId(), nullptr, entry("b", "1")}});
+
+    EXPECT_EQ(history.allVersions().size(), 2u);
+    EXPECT_EQ(history.redo(), nullptr);
+}
+
+TEST_F(VersionHistoryTest, PruneKeepsCurrentAndViews)
+{
+    VersionHistory history(kFile);
+    std::vector<uint64_t> ids;
+    history.reset({}, ids);
+    std::vector<uint64_t> added;
+    for (int i = 0; i < 10; ++i)
+    {
+        added.push_back(history.newEntryId());
+        history.commit("Add", {EntryChange{added.back(), nullptr, entry("e" + std::to_string(i), "p")}});
+    }
+    history.undo();
+
+    EXPECT_EQ(history.pruneToCount(3), 8u);
+    ASSERT_EQ(history.allVersions().size(), 3u);
+    EXPECT_EQ(history.find(2), nullptr);
+    ASSERT_NE(history.find(9), nullptr);
+    EXPECT_EQ(history.find(9)->entries.size(), 9u);
+
+    VersionHistory reloaded(kFile);
+    ASSERT_TRUE(reloaded.load());
+    EXPECT_EQ(reloaded.allVersions().size(), 3u);
+    EXPECT_EQ(reloaded.current().number, 9u);
+    EXPECT_EQ(reloaded.pruneOlderThan(std::time(nullptr) + 60), 1u);
+}
+
+TEST_F(VersionHistoryTest, ResetWritesNothingAndKeepsOldLog)
+{
+    const std::string backup = std::string(kFile) + ".bak";
+    std::remove(backup.c_str());
+    {
+        VersionHistory history(kFile);
+        std::vector<uint64_t> ids;
+        history.reset({}, ids);
+        EXPECT_FALSE(std::ifstream(kFile).is_open());
+        history.commit("Add a", {EntryChange{history.newEntryId(), nullptr, entry("a", "1")}});
+    }
+
+    VersionHistory replacement(kFile);
+    std::vector<uint64_t> ids;
+    replacement.reset({Password{"b", "2", "", "", ""}}, ids);
+    VersionHistory unchanged(kFile);
+    ASSERT_TRUE(unchanged.load());
+    EXPECT_EQ(unchanged.current().description, "Add a");
+
+    replacement.commit("Add c", {EntryChange{replacement.newEntryId(), nullptr, entry("c", "3")}});
+    VersionHistory kept(backup);
+    ASSERT_TRUE(kept.load());
+    EXPECT_EQ(kept.current().description, "Add a");
+    VersionHistory current(kFile);
+    ASSERT_TRUE(current.load());
+    EXPECT_EQ(current.current().entries.size(), 2u);
+    std::remove(backup.c_str());
+}
+
+TEST_F(VersionHistoryTest, TornRecordIsDroppedBeforeNextWrite)
+{
+    {
+        VersionHistory history(kFile);
+        std::vector<uint64_t> ids;
+        history.reset({}, ids);
+        history.commit("Add a", {EntryChange{history.newEntryId(), nullptr, entry("a", "1")}});
+    }
+    {
+        std::ofstream file(kFile, std::ios::binary | std::ios::app);
+        file.write("C\x40\0\0\0partial", 12);
+    }
+
+    VersionHistory history(kFile);
+    ASSERT_TRUE(history.load());
+    EXPECT_EQ(history.allVersions().size(), 2u);
+    history.commit("Add b", {EntryChange{history.newEntryId(), nullptr, entry("b", "2")}});
+    ASSERT_NE(history.undo(), nullptr);
+    ASSERT_TRUE(history.flush());
+
+    VersionHistory reloaded(kFile);
+    ASSERT_TRUE(reloaded.load());
+    EXPECT_EQ(reloaded.allVersions().size(), 3u);
+    EXPECT_EQ(reloaded.current().description, "Add a");
+}